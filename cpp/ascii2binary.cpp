@@ -1,14 +1,147 @@
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <stxxl/sorter>
 #include <tlx/cmdline_parser.hpp>
+#include <tlx/math/ctz.hpp>
 
 #include "defs.hpp"
+#include "util.hpp"
+
+namespace {
+
+constexpr size_t ASCII_CHUNK_SIZE = 8 * UIntScale::Mi;
+// a slot holds the text of a chunk and its edges, at most one per four characters ("1 2\n")
+constexpr size_t ASCII_SLOT_BYTES = ASCII_CHUNK_SIZE + ASCII_CHUNK_SIZE / 4 * sizeof(file_edge_t);
+constexpr size_t ASCII_NUM_SLOTS = std::max<size_t>(LOADER_BUFFER_MEM / ASCII_SLOT_BYTES, 2);
+constexpr char MATRIX_MARKET_BANNER[] = "%%MatrixMarket";
+constexpr uint64_t ASCII_ZEROS = 0x3030303030303030ULL;
+
+struct parse_options {
+	file_node_t add_index;
+	file_node_t subtract_index;
+	bool orient;
+};
+
+struct parsed_chunk {
+	std::vector<file_edge_t> edges;
+	size_t num_invalid = 0;
+};
+
+bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+// converts eight ASCII digits (first digit in the lowest byte) to their value
+uint32_t parse_eight_digits(uint64_t chars) {
+	constexpr uint64_t mask = 0x000000FF000000FFULL;
+	constexpr uint64_t mul1 = 100 + (1000000ULL << 32);
+	constexpr uint64_t mul2 = 1 + (10000ULL << 32);
+	uint64_t val = chars - ASCII_ZEROS;
+	val = (val * 10) + (val >> 8);
+	val = (((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32;
+	return static_cast<uint32_t>(val);
+}
+
+// parses an unsigned decimal starting at p, eight characters at a time while possible
+file_node_t parse_number(const char*& p, const char* end) {
+	static constexpr uint64_t pow10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+	file_node_t x = 0;
+	while (end - p >= 8) {
+		uint64_t chars;
+		std::memcpy(&chars, p, 8);
+		// the high bit of a byte is set iff it is not a digit
+		const uint64_t shifted = chars ^ ASCII_ZEROS;
+		const uint64_t non_digits = (((shifted & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | shifted) & 0x8080808080808080ULL;
+		const unsigned digits = non_digits ? tlx::ctz(non_digits) / 8 : 8;
+		if (!digits)
+			return x;
+		if (digits < 8) {
+			// move the digits to the top and pad with leading zeros
+			chars = (chars << (8 * (8 - digits))) | (ASCII_ZEROS >> (8 * digits));
+		}
+		x = x * pow10[digits] + parse_eight_digits(chars);
+		p += digits;
+		if (digits < 8)
+			return x;
+	}
+	for (; p < end && is_digit(*p); ++p) {
+		x = x * 10 + static_cast<file_node_t>(*p - '0');
+	}
+	return x;
+}
+
+// parses all complete lines of [begin, end) into result; lines not starting with a digit are skipped
+void parse_chunk(const char* begin, const char* end, const parse_options& options, parsed_chunk& result) {
+	result.edges.clear();
+	result.num_invalid = 0;
+	auto skip_blanks = [&](const char*& p) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+			++p;
+	};
+	for (const char* p = begin; p < end; ) {
+		skip_blanks(p);
+		if (p < end && is_digit(*p)) {
+			file_node_t u = parse_number(p, end);
+			skip_blanks(p);
+			if (p < end && is_digit(*p)) {
+				file_node_t v = parse_number(p, end);
+				u = u + options.add_index - options.subtract_index;
+				v = v + options.add_index - options.subtract_index;
+				if (options.orient && u > v) {
+					std::swap(u, v);
+				}
+				if (TLX_UNLIKELY(u == MIN_NODE || v == MIN_NODE || u > MAX_VALID_NODE || v > MAX_VALID_NODE)) {
+					++result.num_invalid;
+				} else {
+					result.edges.push_back(file_edge_t{u, v});
+				}
+			}
+		}
+		// ignore the rest of the line (e.g. weights)
+		p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (!p)
+			break;
+		++p;
+	}
+}
+
+// skips the banner, comments and the size line "rows cols nnz" of a Matrix Market file; returns whether there was a banner
+bool skip_matrix_market_header(std::ifstream& in) {
+	constexpr size_t banner_length = sizeof(MATRIX_MARKET_BANNER) - 1;
+	char banner[banner_length];
+	const auto start = in.tellg();
+	in.read(banner, banner_length);
+	const bool found = in.gcount() == static_cast<std::streamsize>(banner_length)
+		&& std::memcmp(banner, MATRIX_MARKET_BANNER, banner_length) == 0;
+	if (!found) {
+		in.clear();
+		in.seekg(start);
+		return false;
+	}
+	std::string line;
+	std::getline(in, line); // rest of the banner
+	while (std::getline(in, line)) {
+		const size_t first = line.find_first_not_of(" \t\r");
+		if (first != std::string::npos && line[first] != '%') {
+			break; // size line
+		}
+	}
+	return true;
+}
+
+} // namespace
 
 int main(int argc, char* argv[]) {
 	tlx::CmdlineParser cp;
-	cp.set_description("Read ASCII edge list file and output binary file");
+	cp.set_description("Read ASCII edge list file and output binary file; lines not starting with a node id and Matrix Market headers are ignored");
 
 	std::string input_filename;
 	cp.add_param_string("input", input_filename, "Input ASCII file");
@@ -19,32 +152,181 @@ int main(int argc, char* argv[]) {
 	size_t skip_lines = 0;
 	cp.add_size_t("skip", skip_lines, "Optionally skip lines at beginning of file");
 
-	node_t subtract_index = 0;
+	size_t subtract_index = 0;
 	cp.add_size_t("subtract", subtract_index, "Optionally decrease indices by this amount");
 
-	node_t add_index = 0;
+	size_t add_index = 0;
 	cp.add_size_t("add", add_index, "Optionally increase indices by this amount (only relevant if minimum index was < 1 such as 0)");
 
+	bool orient = false;
+	cp.add_flag("orient", orient, "Orient every edge from smaller to larger id");
+
+	bool sort = false;
+	cp.add_flag("sort", sort, "Sort the edges by (u, v) before writing them");
+
+	bool dedup = false;
+	cp.add_flag("dedup", dedup, "Drop parallel edges (only consecutive ones unless sorting)");
+
+	size_t num_threads = std::thread::hardware_concurrency();
+	cp.add_size_t("threads", num_threads, "Number of parser threads");
+
 	if (!cp.process(argc, argv)) {
 		return -1;
 	}
 
-	std::ifstream in(input_filename);
-	std::ofstream out(output_filename, std::ios::binary);
-	std::string line;
-	node_t edge[2];
+	const parse_options options{add_index, subtract_index, orient};
+	std::ifstream in(input_filename, std::ios::binary);
+	if (!in) {
+		std::cout << "Could not open " << input_filename << std::endl;
+		return -1;
+	}
 
 	// skip some lines
+	std::string line;
 	for (size_t i=0; i<skip_lines; ++i) {
 		std::getline(in, line);
 	}
+	if (skip_matrix_market_header(in)) {
+		std::cout << "Skipped Matrix Market header and size line" << std::endl;
+	}
 
-	while (std::getline(in, line)) {
-		char* sep = line.data();
-		edge[0] = std::strtoull(sep, &sep, 10) + add_index - subtract_index;
-		edge[1] = std::strtoull(sep, NULL, 10) + add_index - subtract_index;
-		assert(edge[0] > MIN_NODE && edge[0] < MAX_NODE);
-		assert(edge[1] > MIN_NODE && edge[1] < MAX_NODE);
-		out.write((char*)(&edge[0]), bytes_per_edge);
+	GraphWriter out(output_filename, true);
+	using edge_sorter_t = stxxl::sorter<edge_t, edge_lt_ordering>;
+	std::unique_ptr<edge_sorter_t> sorter;
+	if (sort) {
+		sorter = std::make_unique<edge_sorter_t>(edge_lt_ordering(), SORTER_MEM);
+	}
+
+	size_t num_invalid = 0;
+	size_t num_parallel = 0;
+	edge_t prev = MIN_EDGE;
+	auto emit = [&](const edge_t& e) {
+		if (dedup && e == prev) {
+			++num_parallel;
+			return;
+		}
+		prev = e;
+		out.push(e);
+	};
+
+	// chunks are read into a fixed set of slots, parsed by a fixed set of workers and consumed in file order
+	struct slot_t {
+		std::string text;
+		parsed_chunk parsed;
+		size_t filled = 0; // chunk + 1 once its text is read
+		size_t parsed_chunk_id = 0; // chunk + 1 once it is parsed
+	};
+	std::vector<slot_t> slots(ASCII_NUM_SLOTS);
+	for (auto& slot : slots) {
+		slot.text.reserve(ASCII_CHUNK_SIZE);
+		slot.parsed.edges.reserve(ASCII_CHUNK_SIZE / 8);
+	}
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t num_chunks = 0;
+	bool eof = false;
+
+	// worker w parses chunks w, w + num_workers, ...
+	const size_t num_workers = std::min(std::max<size_t>(num_threads, 1), slots.size());
+	auto work = [&](size_t first_chunk) {
+		for (size_t chunk = first_chunk; ; chunk += num_workers) {
+			slot_t& slot = slots[chunk % slots.size()];
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return slot.filled == chunk + 1 || (eof && chunk >= num_chunks); });
+				if (slot.filled != chunk + 1) return;
+			}
+			parse_chunk(slot.text.data(), slot.text.data() + slot.text.size(), options, slot.parsed);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.parsed_chunk_id = chunk + 1;
+			}
+			changed.notify_all();
+		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(num_workers);
+	for (size_t w = 0; w < num_workers; ++w) {
+		workers.emplace_back(work, w);
+	}
+
+	size_t num_consumed = 0;
+	auto consume_next = [&] {
+		slot_t& slot = slots[num_consumed % slots.size()];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return slot.parsed_chunk_id == num_consumed + 1; });
+		}
+		++num_consumed;
+		num_invalid += slot.parsed.num_invalid;
+		for (const auto& fe : slot.parsed.edges) {
+			const edge_t e{static_cast<node_t>(fe.u), static_cast<node_t>(fe.v)};
+			if (sort) {
+				sorter->push(e);
+			} else {
+				emit(e);
+			}
+		}
+	};
+
+	std::string carry;
+	while (in) {
+		// the slot of the next chunk is free once its previous chunk is consumed
+		while (num_consumed + slots.size() <= num_chunks) {
+			consume_next();
+		}
+		std::string& text = slots[num_chunks % slots.size()].text;
+		text.assign(carry);
+		carry.clear();
+		const size_t old_size = text.size();
+		text.resize(old_size + ASCII_CHUNK_SIZE);
+		in.read(&text[old_size], ASCII_CHUNK_SIZE);
+		text.resize(old_size + in.gcount());
+		if (in) {
+			// only complete lines are parsed; the rest is prepended to the next chunk
+			const size_t last_newline = text.rfind('\n');
+			if (last_newline == std::string::npos) {
+				carry.swap(text);
+				continue;
+			}
+			carry.assign(text, last_newline + 1, std::string::npos);
+			text.resize(last_newline + 1);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slots[num_chunks % slots.size()].filled = num_chunks + 1;
+			++num_chunks;
+		}
+		changed.notify_all();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		eof = true;
+	}
+	changed.notify_all();
+	while (num_consumed < num_chunks) {
+		consume_next();
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	if (sort) {
+		sorter->sort();
+		for (; !sorter->empty(); ++(*sorter)) {
+			emit(**sorter);
+		}
+	}
+	out.close();
+
+	std::cout << "Wrote " << out.size() << " edges" << std::endl;
+	if (num_parallel > 0) {
+		std::cout << "Dropped " << num_parallel << " parallel edges" << std::endl;
+	}
+	if (num_invalid > 0) {
+		std::cout << "Dropped " << num_invalid << " edges with node ids outside of [1, " << MAX_VALID_NODE << "]" << std::endl;
 	}
+	return 0;
 }
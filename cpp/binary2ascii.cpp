@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "defs.hpp"
+#include "util.hpp"
 
 
 int main(int argc, char* argv[]) {
@@ -10,9 +11,11 @@ int main(int argc, char* argv[]) {
 		return 0;
 	}
 
+	const graph_header_t header = read_graph_header(argv[1]);
 	std::ifstream in(argv[1], std::ios::binary);
-	node_t edge[2];
-	while (in.read((char*)edge, bytes_per_edge)) {
+	in.seekg(header.data_offset);
+	file_node_t edge[2];
+	for (size_t i = 0; i < header.num_edges && in.read((char*)edge, bytes_per_edge); ++i) {
 		std::cout << edge[0] << " " << edge[1] << std::endl;
 	}
 }
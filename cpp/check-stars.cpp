@@ -17,9 +17,9 @@ int main(int argc, char *argv[]) {
 	robin_hood::unordered_map<node_t,bool> selfloop;
 	{
 		std::ifstream in(argv[1]);
-		node_t edge[2];
+		file_node_t edge[2];
 		while (in.read((char*)edge, bytes_per_edge)) {
-			node_t& v = edge[1];
+			file_node_t& v = edge[1];
 			auto lookup = sizes.find(v);
 			if (lookup == sizes.end()) {
 				sizes[v] = 1;
@@ -17,19 +17,19 @@ int main(int argc, char *argv[]) {
     stxxl::sorter<edge_t, edge_less_cmp> edges_r(edge_less_cmp(), SORTER_MEM);
     {
         std::ifstream in(argv[1]);
-        node_t edge[2];
+        file_node_t edge[2];
         while (in.read((char*)edge, bytes_per_edge)) {
-            node_t& u = edge[0];
-            node_t& v = edge[1];
+            file_node_t& u = edge[0];
+            file_node_t& v = edge[1];
             edges_l.push(edge_t{u, v});
         }
     }
     {
         std::ifstream in(argv[2]);
-        node_t edge[2];
+        file_node_t edge[2];
         while (in.read((char*)edge, bytes_per_edge)) {
-            node_t& u = edge[0];
-            node_t& v = edge[1];
+            file_node_t& u = edge[0];
+            file_node_t& v = edge[1];
             edges_r.push(edge_t{u, v});
         }
     }
@@ -7,8 +7,17 @@
 #include <tlx/die.hpp>
 #endif
 
+// node ids are 64 bit by default; define NODE_ID_32BIT to halve the size of edges
+// and component labels in every sorter and stream for graphs with < 2^31 nodes
+#ifdef NODE_ID_32BIT
+using node_t = uint32_t;
+#else
 using node_t = uint64_t;
-constexpr size_t bytes_per_edge = sizeof(node_t)*2;
+#endif
+
+// graph files always store 64 bit node ids, independent of node_t
+using file_node_t = uint64_t;
+constexpr size_t bytes_per_edge = sizeof(file_node_t)*2;
 
 /// Types for scales
 template <typename T>
@@ -31,6 +40,11 @@ constexpr size_t INTERNAL_PQ_MEM = INTERNAL_SORT_MEM;
 constexpr size_t SORTER_MEM = INTERNAL_SORT_MEM;
 constexpr size_t PQ_POOL_MEM = 128 * UIntScale::Mi;
 constexpr size_t MAX_PQ_SIZE = UIntScale::Gi; // is multiplied by 1024 according to docs
+constexpr size_t LOADER_CHUNK_SIZE = 8 * UIntScale::Mi;
+constexpr size_t LOADER_BUFFER_MEM = 256 * UIntScale::Mi;
+constexpr size_t EDGE_STREAM_POOL_MEM = 128 * UIntScale::Mi; // shared by all EdgeStreams
+constexpr size_t WRITER_CHUNK_SIZE = 4 * UIntScale::Mi;
+constexpr size_t WRITER_NUM_BUFFERS = 4;
 
 class edge_t {
 public:
@@ -69,6 +83,55 @@ using em_mapping = stxxl::vector<edge_t>;
 
 constexpr node_t MIN_NODE = std::numeric_limits<node_t>::min();
 constexpr node_t MAX_NODE = std::numeric_limits<node_t>::max();
+// EdgeStream reserves the highest bit of a node id
+constexpr node_t MAX_VALID_NODE = MAX_NODE >> 1;
+
+struct file_edge_t {
+	file_node_t u;
+	file_node_t v;
+};
+
+// optional header of a graph file; legacy files are a plain sequence of file_edge_t.
+// the magic has its highest bit set and thus can not be the first node id of a legacy file
+constexpr uint64_t GRAPH_HEADER_MAGIC = 0xC0CC0000EDCE0001ULL;
+constexpr uint32_t GRAPH_HEADER_VERSION = 1;
+// edges start at this offset, which keeps them aligned for direct I/O
+constexpr size_t GRAPH_HEADER_BYTES = 4 * UIntScale::Ki;
+// every GRAPH_INDEX_STRIDE-th edge of a sorted file is recorded in the source index
+constexpr size_t GRAPH_INDEX_STRIDE = 64 * UIntScale::Ki;
+
+enum graph_flags : uint32_t {
+	GRAPH_NODE_COUNT = 1,   // num_nodes is the exact number of distinct nodes
+	GRAPH_SORTED = 2,       // edges are sorted by (u, v)
+	GRAPH_ORIENTED = 4,     // u < v for every edge
+	GRAPH_DEDUPLICATED = 8, // no parallel edges (only meaningful if sorted)
+	GRAPH_SOURCE_INDEX = 16 // {u, position} pairs follow the edges
+};
+
+struct graph_header_t {
+	uint64_t magic = 0;
+	uint32_t version = 0;
+	uint32_t flags = 0;
+	uint64_t data_offset = 0;   // byte offset of the first edge
+	uint64_t num_edges = 0;
+	uint64_t num_nodes = 0;
+	uint64_t max_node_id = 0;
+	uint64_t index_offset = 0;  // byte offset of the source index
+	uint64_t index_entries = 0;
+
+	bool has_header() const {
+		return magic == GRAPH_HEADER_MAGIC;
+	}
+	bool has(graph_flags flag) const {
+		return flags & flag;
+	}
+	//! upper bound on the number of nodes, or 0 if unknown
+	uint64_t node_bound() const {
+		if (has(GRAPH_NODE_COUNT))
+			return num_nodes;
+		return has_header() ? max_node_id + 1 : 0;
+	}
+};
 #define MIN_EDGE edge_t{MIN_NODE, MIN_NODE}
 #define MAX_EDGE edge_t{MAX_NODE, MAX_NODE}
 // for regular sorting
@@ -6,6 +6,7 @@
 #include <stxxl/sorter>
 
 #include "defs.hpp"
+#include "util.hpp"
 #include "robin_hood.h"
 
 int main(int argc, char *argv[]) {
@@ -25,8 +26,8 @@ int main(int argc, char *argv[]) {
 	using comp = stxxl::comparator<node_t>;
 	stxxl::sorter<node_t, comp> sorter(comp(), 2*UIntScale::Gi);
 
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector E(input_file);
+	em_edge_vector E;
+	read_graph(input_filename, E);
 
 	std::cout << "Read ... " << std::flush;
 	for (const auto& e: E) {
@@ -3,6 +3,7 @@
 #include <map>
 
 #include "defs.hpp"
+#include "util.hpp"
 
 int main(int argc, char *argv[]) {
 	if (argc != 2) {
@@ -19,9 +20,11 @@ int main(int argc, char *argv[]) {
 			counts[x]++;
 		}
 	};
+	const graph_header_t header = read_graph_header(argv[1]);
 	std::ifstream in(argv[1], std::ios::binary);
-	node_t edge[2];
-	while (in.read(reinterpret_cast<char *>(&edge), 2*sizeof(node_t))) {
+	in.seekg(header.data_offset);
+	file_node_t edge[2];
+	for (size_t i = 0; i < header.num_edges && in.read(reinterpret_cast<char *>(&edge), bytes_per_edge); ++i) {
 		assert(edge[0] < edge[1]);
 		assert(edge[0] > 0);
 		increment_count(edge[0]);
@@ -23,7 +23,7 @@ int main(int argc, char* argv[]) {
 
 	std::ofstream out(output_filename, std::ios::binary);
 
-	node_t edge[2];
+	file_node_t edge[2];
 	for (node_t clique=0; clique<num_cliques; ++clique) {
 		node_t first = (clique*clique_size)+1;
 		node_t last = first+clique_size-1;
@@ -29,7 +29,7 @@ int main(int argc, char* argv[]) {
 
 	std::ofstream out(output_filename, std::ios::binary);
 
-	node_t edge[2];
+	file_node_t edge[2];
 	for (node_t layer=0; layer<layers; ++layer) {
 		node_t layer_start = layer*width*height+1;
 		for (node_t row=0; row<height; ++row) {
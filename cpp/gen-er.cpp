@@ -34,7 +34,7 @@ int main(int argc, char* argv[]) {
 	std::default_random_engine gen{ rand_dev() };
 	std::geometric_distribution<size_t> dist(p);
 	size_t row_width = n-1;
-	node_t edge[2];
+	file_node_t edge[2];
 	// index 0 is "u", index 1 is "v"
 	edge[0] = 1;
 	node_t v_offset = 0;
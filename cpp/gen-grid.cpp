@@ -11,7 +11,7 @@ int main(int argc, char* argv[]) {
 	size_t n = std::stol(argv[1]);
 	size_t m = std::stol(argv[2]);
 	std::ofstream out(argv[3], std::ios::binary);
-	node_t edge[2];
+	file_node_t edge[2];
 
 	for (node_t row=0; row<m-1; ++row) {
 		for (node_t col=0; col<n-1; ++col) {
@@ -5,6 +5,7 @@
 #include <tlx/cmdline_parser.hpp>
 
 #include "defs.hpp"
+#include "util.hpp"
 
 
 int main(int argc, char *argv[]) {
@@ -18,6 +19,12 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
+	const graph_header_t header = read_graph_header(input_filename);
+	if (header.has_header()) {
+		std::cout << "max node id," << header.max_node_id << std::endl;
+		return 0;
+	}
+
 	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
 	const em_edge_vector E(input_file);
 	node_t max_node_seen = MIN_NODE;
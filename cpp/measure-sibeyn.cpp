@@ -35,8 +35,8 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector E(input_file);
+	em_edge_vector E;
+	read_graph(input_filename, E);
 	em_edge_vector sibeyn_tree; // output of Sibeyn
 
 	bool save_output = (output_filename != "");
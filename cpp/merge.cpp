@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "defs.hpp"
+#include "util.hpp"
 #include <stxxl/sorter>
 
 int main(int argc, char *argv[]) {
@@ -16,11 +17,13 @@ int main(int argc, char *argv[]) {
   size_t edges_read = 0;
   for (int i = 2; i < argc; ++i) {
     std::cout << "Read file " << argv[i] << " ... " << std::flush;
+    const graph_header_t header = read_graph_header(argv[i]);
     std::ifstream in(argv[i], std::ios::binary);
-    node_t edge[2];
+    in.seekg(header.data_offset);
+    file_node_t edge[2];
 
     size_t read = 0;
-    while (in.read((char *)edge, bytes_per_edge)) {
+    while (read < header.num_edges && in.read((char *)edge, bytes_per_edge)) {
       if (edge[0] > edge[1])
         std::swap(edge[0], edge[1]);
 
@@ -39,7 +42,7 @@ int main(int argc, char *argv[]) {
   std::cout << "done." << std::endl;
 
   std::cout << "Write result ... " << std::endl;
-  std::ofstream out(argv[1], std::ios::binary);
+  GraphWriter out(argv[1], true);
   edge_t prev_edge = MAX_EDGE;
 
   for (; !sorter.empty(); ++sorter) {
@@ -47,7 +50,7 @@ int main(int argc, char *argv[]) {
     if (prev_edge == edge)
       continue;
 
-    out.write(reinterpret_cast<char *>(&edge), sizeof(edge));
+    out.push(edge);
 
     prev_edge = edge;
   }
@@ -31,8 +31,9 @@ int main(int argc, char *argv[]) {
 
 	std::mt19937_64 gen(seed);
 	// opening graph
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(filename, foxxll::file::RDWR | foxxll::file::DIRECT);
-	em_edge_vector E(input_file);
+	const bool with_header = read_graph_header(filename).has_header();
+	em_edge_vector E;
+	read_graph(filename, E);
 
 	node_t max_id = 0;
 	if (num_nodes == 0) {
@@ -75,4 +76,11 @@ int main(int argc, char *argv[]) {
 
 	// now sort the thing again
 	stxxl::sort(E.begin(), E.end(), edge_lt_ordering(), INTERNAL_SORT_MEM);
+
+	// overwrite the input, keeping its format; a header gets the new flags and index
+	GraphWriter out(filename, with_header);
+	for (const auto& e : E) {
+		out.push(e);
+	}
+	out.close();
 }
@@ -42,5 +42,5 @@ int main(int argc, char *argv[]) {
 	orient_smaller_to_larger(E);
 	stxxl::sort(E.begin(), E.end(), edge_lt_ordering(), INTERNAL_SORT_MEM);
 
-	write_graph(E, argv[2]);
+	write_graph(E, argv[2], true, n);
 }
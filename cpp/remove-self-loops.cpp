@@ -20,8 +20,8 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY);
-	const em_edge_vector E_in(input_file);
+	em_edge_vector E_in;
+	read_graph(input_filename, E_in);
 
 	foxxll::file_ptr output_file = tlx::make_counting<foxxll::syscall_file>(output_filename, foxxll::file::RDWR | foxxll::file::CREAT);
 	em_edge_vector E_out(output_file);
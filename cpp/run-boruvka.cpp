@@ -1,4 +1,5 @@
 #include <iostream>
+#include <memory>
 
 #include <foxxll/io.hpp>
 #include <foxxll/io/iostats.hpp>
@@ -20,7 +21,7 @@ int main(int argc, char *argv[]) {
 	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
 
 	size_t num_nodes = 0;
-	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph");
+	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph (default: taken from graph header)");
 
 	std::string output_filename = "";
 	cp.add_opt_param_string("output", output_filename, "Output graph file");
@@ -29,22 +30,26 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
+	if (num_nodes == 0) {
+		num_nodes = read_graph_header(input_filename).node_bound();
+	}
+
 	foxxll::scoped_print_iostats global_stats("total");
 	EdgeStream edge_stream;
 	size_t num_edges;
 	{
 		foxxll::scoped_print_iostats read_stats("read_graph");
-		foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-		const em_edge_vector E(input_file);
-		for (const auto& e: E) {
-			edge_stream.push(e);
-		}
+		num_edges = read_graph_to_stream(input_filename, edge_stream);
 		edge_stream.rewind();
 		if (num_nodes == 0) {
 			std::cout << "Will explicitly count number of nodes" << std::endl;
+			em_edge_vector E;
+			for (; !edge_stream.empty(); ++edge_stream) {
+				E.push_back(*edge_stream);
+			}
+			edge_stream.rewind();
 			num_nodes = external_number_of_nodes(E).first;
 		}
-		num_edges = E.size();
 	}
 
 	std::cout << "Graph has " << num_nodes << " nodes and " << num_edges << " edges" << std::endl;
@@ -54,7 +59,11 @@ int main(int argc, char *argv[]) {
 	}
 
 	node_t num_counted_nodes = 0;
-	em_mapping cc_map; // to hold result
+	// labels are streamed to disk as they are produced
+	std::unique_ptr<GraphWriter> cc_writer;
+	if (save_output) {
+		cc_writer = std::make_unique<GraphWriter>(output_filename);
+	}
 	{
 		foxxll::scoped_print_iostats alg_stats("algorithm");
 
@@ -63,14 +72,16 @@ int main(int argc, char *argv[]) {
 		for (; !boruvka_algo.empty(); ++boruvka_algo) {
 			const auto node_label = *boruvka_algo;
 			++num_counted_nodes;
-			cc_map.push_back(edge_t(node_label.node, node_label.load));
+			if (save_output) {
+				cc_writer->push(node_label.node, node_label.load);
+			}
 		}
 	}
 	std::cout << "num_nodes " << num_nodes << std::endl;
 	std::cout << "num_counted_nodes " << num_counted_nodes << std::endl;
 
 	if (save_output) {
-		write_graph(cc_map, output_filename);
+		cc_writer->close();
 	}
 	return 0;
 }
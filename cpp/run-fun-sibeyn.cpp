@@ -1,4 +1,6 @@
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #include <foxxll/io.hpp>
 #include <tlx/cmdline_parser.hpp>
@@ -9,6 +11,8 @@
 #include "streaming/containers/EdgeStream.h"
 #include "streaming/contraction/Sibeyn.hpp"
 #include "streaming/FunctionalSubproblemManager.h"
+#include "streaming/utils/MemoryBudget.h"
+#include "streaming/utils/PhaseTelemetry.h"
 
 int main(int argc, char *argv[]) {
 	tlx::CmdlineParser cp;
@@ -21,33 +25,59 @@ int main(int argc, char *argv[]) {
 	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
 
 	size_t num_nodes = 0;
-	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph");
+	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph (default: taken from graph header)");
 
 	std::string output_filename = "";
 	cp.add_opt_param_string("output", output_filename, "Output graph file");
 
+	std::string forest_filename = "";
+	cp.add_string("forest", forest_filename, "Also write a spanning forest of the input graph to this file");
+
 	unsigned algorithm_variant = 0;
-	cp.add_unsigned("variant", algorithm_variant, "Version of algorithm to use; leave 0 for \"real\" KKT");
+	cp.add_unsigned("variant", algorithm_variant, "Version of algorithm to use; leave 0 for \"real\" KKT, 10 adapts to the graph at runtime, 11 splits into 4 sample classes");
 
 	unsigned seed = std::random_device{}();
 	cp.add_unsigned("seed", seed, "Random seed to use");
 
+	size_t stream_pool_bytes = 0;
+	cp.add_bytes("stream_pool", stream_pool_bytes, "Memory shared by the block buffers of all edge streams (default: a share of the memory budget)");
+
+	double sketch_error = FunctionalSubproblemManager<EdgeStream, SibeynContraction>::DEFAULT_SKETCH_ERROR;
+	cp.add_double("sketch_error", sketch_error, "Relative error tolerated by node bounds from distinct element sketches (0 disables them)");
+
+	size_t num_threads = std::thread::hardware_concurrency();
+	cp.add_size_t("threads", num_threads, "Number of threads of the graph loader and the base case (default: all hardware threads)");
+
+	std::string telemetry_filename = "";
+	cp.add_string("telemetry", telemetry_filename, "Record the phases of every recursion level to this file (CSV if it ends in .csv, JSON lines otherwise)");
+
 	if (!cp.process(argc, argv)) {
 		return -1;
 	}
 
 	if (num_nodes == 0) {
-		std::cout << "Node counting temporarily disabled, please specify using num_nodes" << std::endl;
+		num_nodes = read_graph_header(input_filename).node_bound();
+		if (num_nodes == 0) {
+			std::cout << "Graph file has no header, please specify using num_nodes" << std::endl;
+			return -1;
+		}
+	}
+
+	if (!telemetry_filename.empty() && !PhaseTelemetry::instance().open(telemetry_filename)) {
+		std::cout << "Cannot write telemetry to " << telemetry_filename << std::endl;
 		return -1;
 	}
 
 	std::cout << "Running with seed " << seed << std::endl;
+	// sorters, priority queues and edge streams are served from the budget, the base case gets the rest
+	MemoryBudget::instance().set_budget(internal_memory_bytes, stream_pool_bytes);
+	EdgeStreamPool::instance().set_budget(MemoryBudget::instance().stream_pool_mem());
 	foxxll::scoped_print_iostats global_stats("total");
 	EdgeStream input_stream;
 	size_t num_edges;
 	{
 		foxxll::scoped_print_iostats read_stats("read_graph");
-		num_edges = read_graph_to_stream(input_filename, input_stream);
+		num_edges = read_graph_to_stream(input_filename, input_stream, num_threads);
 		input_stream.consume();
 	}
 
@@ -57,24 +87,43 @@ int main(int argc, char *argv[]) {
 		std::cout << "Output will not be saved" << std::endl;
 	}
 
-	em_mapping cc_map; // to hold result
+	// labels are streamed to disk as they are produced
+	std::unique_ptr<GraphWriter> cc_writer;
+	if (save_output) {
+		cc_writer = std::make_unique<GraphWriter>(output_filename);
+	}
 	node_t num_counted_nodes = 0; // for debugging
 	{
 		foxxll::scoped_print_iostats alg_stats("algorithm");
 		policy_t policy = variant_policies[algorithm_variant];
 		// note: parameter given is number of bytes of main memory
-		FunctionalSubproblemManager<EdgeStream, SibeynContraction> funman(input_stream, internal_memory_bytes, num_nodes, policy, seed);
+		FunctionalSubproblemManager<EdgeStream, SibeynContraction> funman(input_stream, MemoryBudget::instance().basecase_mem(), num_nodes, policy, seed, !forest_filename.empty(), sketch_error, num_threads);
 		for (; !funman.empty(); ++funman) {
 			const auto node_label = *funman;
 			++num_counted_nodes;
-			cc_map.push_back(edge_t(node_label.node, node_label.load));
+			if (save_output) {
+				cc_writer->push(node_label.node, node_label.load);
+			}
+		}
+
+		if (!forest_filename.empty()) {
+			GraphWriter forest_writer(forest_filename);
+			size_t num_forest_edges = 0;
+			for (auto & forest = funman.forest(); !forest.empty(); ++forest) {
+				const auto edge = *forest;
+				forest_writer.push(edge.u, edge.v);
+				++num_forest_edges;
+			}
+			forest_writer.close();
+			std::cout << "num_forest_edges " << num_forest_edges << std::endl;
 		}
 	}
 	std::cout << "num_nodes " << num_nodes << std::endl;
 	std::cout << "num_counted_nodes " << num_counted_nodes << std::endl;
 
 	if (save_output) {
-		write_graph(cc_map, output_filename);
+		cc_writer->close();
 	}
+	PhaseTelemetry::instance().close();
 	return 0;
 }
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <foxxll/io.hpp>
+#include <stxxl/sorter>
+#include <tlx/cmdline_parser.hpp>
+
+#include "defs.hpp"
+#include "util.hpp"
+#include "variants.hpp"
+#include "streaming/containers/EdgeStream.h"
+#include "streaming/contraction/Sibeyn.hpp"
+#include "streaming/merging/ComponentMerger.h"
+#include "streaming/relabelling/EdgeSorterRelabeller.h"
+#include "streaming/transforms/make_unique_stream.h"
+#include "streaming/FunctionalSubproblemManager.h"
+#include "streaming/utils/MemoryBudget.h"
+
+/*
+ * Updates a component labeling with a batch of new edges.
+ *
+ * The new edges are relabelled to the components of their endpoints (nodes
+ * without a previous label keep their id), which yields a graph with at most
+ * as many edges as the batch. Its components are computed with the
+ * functional algorithm and composed with the previous labels.
+ */
+int main(int argc, char *argv[]) {
+	using edge_sorter_less_t = stxxl::sorter<edge_t, edge_less_cmp>;
+	using edge_sorter_reverse_less_t = stxxl::sorter<edge_t, edge_reverse_less_cmp>;
+	using node_cc_sorter_t = stxxl::sorter<node_component_t, node_component_node_cc_less_cmp>;
+	using cc_node_sorter_t = stxxl::sorter<node_component_t, node_component_cc_node_less_cmp>;
+
+	tlx::CmdlineParser cp;
+	cp.set_description("Update the connected components of a graph after inserting a batch of edges");
+
+	std::string labels_filename;
+	cp.add_param_string("labels", labels_filename, "Previous component labels (node, component) as written by run-fun-sibeyn");
+
+	std::string edges_filename;
+	cp.add_param_string("edges", edges_filename, "Graph file of the new edges");
+
+	size_t internal_memory_bytes;
+	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
+
+	std::string output_filename = "";
+	cp.add_opt_param_string("output", output_filename, "Output label file");
+
+	unsigned algorithm_variant = 0;
+	cp.add_unsigned("variant", algorithm_variant, "Version of algorithm to use; leave 0 for \"real\" KKT, 10 adapts to the graph at runtime, 11 splits into 4 sample classes");
+
+	unsigned seed = std::random_device{}();
+	cp.add_unsigned("seed", seed, "Random seed to use");
+
+	size_t stream_pool_bytes = 0;
+	cp.add_bytes("stream_pool", stream_pool_bytes, "Memory shared by the block buffers of all edge streams (default: a share of the memory budget)");
+
+	size_t num_threads = std::thread::hardware_concurrency();
+	cp.add_size_t("threads", num_threads, "Number of threads of the graph loader and the base case (default: all hardware threads)");
+
+	if (!cp.process(argc, argv)) {
+		return -1;
+	}
+
+	std::cout << "Running with seed " << seed << std::endl;
+	MemoryBudget::instance().set_budget(internal_memory_bytes, stream_pool_bytes);
+	EdgeStreamPool::instance().set_budget(MemoryBudget::instance().stream_pool_mem());
+	foxxll::scoped_print_iostats global_stats("total");
+
+	// previous labels, once by node for relabelling and once by component for composing;
+	// the latter is held while the algorithm runs
+	const size_t labels_sorter_mem = MemoryBudget::instance().sorter_mem();
+	MemoryReservation labels_reservation(2 * labels_sorter_mem);
+	node_cc_sorter_t labels_by_node(node_component_node_cc_less_cmp(), labels_sorter_mem);
+	cc_node_sorter_t labels_by_cc(node_component_cc_node_less_cmp(), labels_sorter_mem);
+	size_t num_labels;
+	{
+		foxxll::scoped_print_iostats read_stats("read_labels");
+		struct label_pusher {
+			node_cc_sorter_t& by_node;
+			cc_node_sorter_t& by_cc;
+			void push(const edge_t& e) {
+				by_node.push(node_component_t{e.u, e.v});
+				by_cc.push(node_component_t{e.u, e.v});
+			}
+		} pusher{labels_by_node, labels_by_cc};
+		num_labels = read_graph_to_stream(labels_filename, pusher, num_threads);
+		labels_by_node.sort_reuse();
+		labels_by_cc.sort();
+	}
+
+	edge_sorter_less_t new_edges(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+	size_t num_new_edges;
+	{
+		foxxll::scoped_print_iostats read_stats("read_edges");
+		struct edge_pusher {
+			edge_sorter_less_t& edges;
+			void push(const edge_t& e) {
+				if (e.u != e.v) edges.push(e);
+			}
+		} pusher{new_edges};
+		num_new_edges = read_graph_to_stream(edges_filename, pusher, num_threads);
+		new_edges.sort();
+	}
+	std::cout << "Updating " << num_labels << " labels with " << num_new_edges << " edges" << std::endl;
+
+	// edges between components; relabelling drops edges within a component
+	EdgeStream component_edges;
+	{
+		foxxll::scoped_print_iostats relabel_stats("relabel");
+		edge_sorter_reverse_less_t sources_relabelled(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
+		EdgeSorterSourceRelabeller(labels_by_node, new_edges, sources_relabelled);
+		new_edges.finish_clear();
+		sources_relabelled.sort();
+
+		labels_by_node.rewind();
+		edge_sorter_less_t relabelled(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+		EdgeSorterTargetRelabeller(labels_by_node, sources_relabelled, relabelled);
+		sources_relabelled.finish_clear();
+		labels_by_node.finish_clear();
+		relabelled.sort();
+
+		make_unique_stream<edge_sorter_less_t> relabelled_uqe(relabelled, edge_t{MAX_NODE, MAX_NODE});
+		for (; !relabelled_uqe.empty(); ++relabelled_uqe) {
+			component_edges.push(*relabelled_uqe);
+		}
+		component_edges.consume();
+	}
+	std::cout << "Component graph has " << component_edges.size() << " edges" << std::endl;
+
+	bool save_output = (output_filename != "");
+	if (!save_output) {
+		std::cout << "Output will not be saved" << std::endl;
+	}
+
+	// composed labels, filled while the algorithm runs
+	const size_t merged_sorter_mem = MemoryBudget::instance().sorter_mem();
+	MemoryReservation merged_reservation(merged_sorter_mem);
+	node_cc_sorter_t merged(node_component_node_cc_less_cmp(), merged_sorter_mem);
+	{
+		foxxll::scoped_print_iostats alg_stats("algorithm");
+		if (component_edges.empty()) {
+			StreamPusher(labels_by_cc, merged);
+		} else {
+			policy_t policy = variant_policies[algorithm_variant];
+			const node_t num_nodes = static_cast<node_t>(2 * component_edges.size());
+			using manager_t = FunctionalSubproblemManager<EdgeStream, SibeynContraction>;
+			manager_t funman(component_edges, MemoryBudget::instance().basecase_mem(), num_nodes, policy, seed, false, manager_t::DEFAULT_SKETCH_ERROR, num_threads);
+			ComponentMerger(labels_by_cc, funman, merged);
+		}
+		merged.sort();
+	}
+
+	std::unique_ptr<GraphWriter> cc_writer;
+	if (save_output) {
+		cc_writer = std::make_unique<GraphWriter>(output_filename);
+	}
+	size_t num_output_labels = 0;
+	make_unique_stream<node_cc_sorter_t> merged_uqe(merged);
+	for (; !merged_uqe.empty(); ++merged_uqe) {
+		const auto node_label = *merged_uqe;
+		++num_output_labels;
+		if (save_output) {
+			cc_writer->push(node_label.node, node_label.load);
+		}
+	}
+	std::cout << "num_output_labels " << num_output_labels << std::endl;
+
+	if (save_output) {
+		cc_writer->close();
+	}
+	return 0;
+}
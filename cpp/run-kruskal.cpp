@@ -16,8 +16,8 @@ int main(int argc, char *argv[]) {
 		return 0;
 	}
 
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(argv[1], foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector E(input_file);
+	em_edge_vector E;
+	read_graph(argv[1], E);
 	foxxll::file::unlink(argv[2]);
 	foxxll::file_ptr output_file = tlx::make_counting<foxxll::syscall_file>(argv[2], foxxll::file::RDWR | foxxll::file::CREAT | foxxll::file::DIRECT);
 	em_edge_vector forest(output_file);
@@ -5,6 +5,7 @@
  */
 
 #include <iostream>
+#include <memory>
 
 #include <foxxll/io/iostats.hpp>
 #include <tlx/cmdline_parser.hpp>
@@ -26,8 +27,8 @@ int main(int argc, char *argv[]) {
 	size_t internal_memory_bytes;
 	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
 
-    node_t max_id = MIN_NODE;
-    cp.add_size_t("max_id", max_id, "Maximum node ID in input graph");
+    size_t max_id = MIN_NODE;
+    cp.add_size_t("max_id", max_id, "Maximum node ID in input graph (default: taken from graph header)");
 
     std::string output_filename = "";
     cp.add_opt_param_string("output", output_filename, "Output graph file");
@@ -42,6 +43,13 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    if (max_id == MIN_NODE) {
+        const graph_header_t header = read_graph_header(input_filename);
+        if (header.has_header()) {
+            max_id = header.max_node_id;
+        }
+    }
+
     // min: semi-external algorithm takes up *all* of M
     size_t min_num_bundles = (max_id * BoundedIntervalKruskal::MEMORY_OVERHEAD_FACTOR * sizeof(node_t)) / internal_memory_bytes;
     // max: bundle buffers take up half of M
@@ -85,21 +93,17 @@ int main(int argc, char *argv[]) {
     size_t num_edges;
     {
         foxxll::scoped_print_iostats read_stats("read_graph");
-        foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-        const em_edge_vector E(input_file);
-        for (const auto& e: E) {
-            edge_stream.push(e);
-        }
+        num_edges = read_graph_to_stream(input_filename, edge_stream);
         edge_stream.rewind();
         if (max_id == MIN_NODE) {
             std::cout << "Maximum node ID not specified, will scan first..." << std::endl;
-            for (const auto& e: E) {
-	            if (e.v > max_id) {
-		            max_id = e.v;
+            for (; !edge_stream.empty(); ++edge_stream) {
+	            if (edge_stream->v > max_id) {
+		            max_id = edge_stream->v;
 	            }
             }
+            edge_stream.rewind();
         }
-        num_edges = E.size();
     }
 
     std::cout << "Minimization is" << (minimize_interbundle_edges ? "" : " not") << " enabled" << std::endl;
@@ -109,7 +113,11 @@ int main(int argc, char *argv[]) {
         std::cout << "Output will not be saved" << std::endl;
     }
 
-    em_mapping cc_map; // to hold result
+    // labels are streamed to disk as they are produced
+    std::unique_ptr<GraphWriter> cc_writer;
+    if (save_output) {
+        cc_writer = std::make_unique<GraphWriter>(output_filename);
+    }
     node_t num_counted_nodes = 0; // for debugging
     {
         foxxll::scoped_print_iostats alg_stats("algorithm");
@@ -117,14 +125,16 @@ int main(int argc, char *argv[]) {
         for (; !sibeyn_with_bundles.empty(); ++sibeyn_with_bundles) {
             const auto node_label = *sibeyn_with_bundles;
             ++num_counted_nodes;
-            cc_map.push_back(edge_t{node_label.u, node_label.v});
+            if (save_output) {
+                cc_writer->push(node_label);
+            }
         }
     }
     std::cout << "max_node_id " << max_id << std::endl;
     std::cout << "num_counted_nodes " << num_counted_nodes << std::endl;
 
     if (save_output) {
-        write_graph(cc_map, output_filename);
+        cc_writer->close();
     }
     return 0;
 }
@@ -19,7 +19,7 @@ int main(int argc, char *argv[]) {
 	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
 
 	size_t num_nodes = 0;
-	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph");
+	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph (default: taken from graph header)");
 
 	std::string output_filename = "";
 	cp.add_opt_param_string("output", output_filename, "Output graph file");
@@ -33,6 +33,9 @@ int main(int argc, char *argv[]) {
 	{
 		foxxll::scoped_print_iostats read_stats("read_graph");
 		read_graph(input_filename, E);
+		if (num_nodes == 0) {
+			num_nodes = read_graph_header(input_filename).node_bound();
+		}
 		if (num_nodes == 0) {
 			std::cout << "Will explicitly count number of nodes" << std::endl;
 			num_nodes = external_number_of_nodes(E).first;
@@ -24,7 +24,7 @@ int main(int argc, char *argv[]) {
 	cp.add_param_bytes("memory", internal_memory_bytes, "Internal memory budget (bytes)");
 
 	size_t num_nodes = 0;
-	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph");
+	cp.add_size_t("num_nodes", num_nodes, "Number of nodes in input graph (default: taken from graph header)");
 
 	std::string output_filename = "";
 	cp.add_opt_param_string("output", output_filename, "Output graph file");
@@ -34,8 +34,11 @@ int main(int argc, char *argv[]) {
 	}
 
 	if (num_nodes == 0) {
-		std::cout << "Node counting temporarily disabled, please specify using num_nodes" << std::endl;
-		return -1;
+		num_nodes = read_graph_header(input_filename).node_bound();
+		if (num_nodes == 0) {
+			std::cout << "Graph file has no header, please specify using num_nodes" << std::endl;
+			return -1;
+		}
 	}
 
 	foxxll::scoped_print_iostats global_stats("total");
@@ -85,10 +88,11 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
-	em_mapping cc_map(stars.size());
-	stxxl::stream::materialize(stars, cc_map.begin(), cc_map.end());
 	if (save_output) {
-		write_graph(cc_map, output_filename);
+		GraphWriter cc_writer(output_filename);
+		for (; !stars.empty(); ++stars) {
+			cc_writer.push(*stars);
+		}
 	}
 
 	return 0;
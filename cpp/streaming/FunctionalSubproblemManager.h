@@ -11,34 +11,50 @@
 //#define VERIFY_CC_MERGE
 //#define VERIFY_CC_STARS
 
-//#define HASH_ESTIMATE_1
-//#define HASH_ESTIMATE_2
 //#define EXPLICIT_COUNT
 
-#if defined(HASH_ESTIMATE_1) && defined(HASH_ESTIMATE_2)
-#error "Use at most one of the two settings for amount of hashing in estimate"
-#endif
+//#define UNCOMPRESSED_SUB_EDGES
+
+//#define SEQUENTIAL_BASECASE
+
+//#define SYNCHRONOUS_HANDOFFS
+
+//#define TWO_PASS_RELABELLING
 
 #if !defined(NDEBUG) || defined(EXPLICIT_COUNT)
 #include "../robin_hood.h"
 #endif
 
+#include <algorithm>
 #include <cmath>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <stxxl/sorter>
 #include "../defs.hpp"
 #include "hungdefs.hpp"
+#include "containers/AsyncSorter.h"
 #include "containers/EdgeStream.h"
+#include "containers/PooledSorter.h"
+#include "containers/PresortedSorter.h"
+#include "basecase/ParallelKruskal.h"
 #include "basecase/PipelinedKruskal.h"
 #include "basecase/StreamKruskal.h"
 #include "merging/ComponentMerger.h"
 #include "relabelling/EdgeSorterRelabeller.h"
+#include "relabelling/ForestLifter.h"
+#include "relabelling/FusedEdgeRelabeller.h"
 #include "transforms/make_unique_stream.h"
+#include "utils/MemoryBudget.h"
+#include "utils/PhaseTelemetry.h"
 #include "utils/StreamPusher.h"
 #include "utils/StreamRandomNeighbour.h"
 #include "utils/StreamSplit.h"
 #include "utils/PowerOfTwoCoin.h"
 #include "distinct_elements/ApplyMeans.h"
 #include "distinct_elements/ApplyMedians.h"
+#include "distinct_elements/HyperLogLog.h"
 #include "distinct_elements/Tidemark.h"
 #include "distinct_elements/MinSketch.h"
 #include "distinct_elements/KSummary.h"
@@ -57,56 +73,131 @@ public:
 template <typename EdgesIn, typename Contraction>
 class FunctionalSubproblemManager {
     // edge stream types
+#ifdef UNCOMPRESSED_SUB_EDGES
     using edge_sequence_t               = EdgeStream;
+#else
+    using edge_sequence_t               = CompressedEdgeStream;
+#endif
+
+    // semi-external base case types
+#ifdef SEQUENTIAL_BASECASE
+    using stream_kruskal_t              = StreamKruskal;
+    using pipelined_kruskal_t           = PipelinedKruskal;
+#else
+    using stream_kruskal_t              = ParallelKruskal;
+    using pipelined_kruskal_t           = ParallelKruskal;
+#endif
     using edge_sorter_less_t            = stxxl::sorter<edge_t, edge_less_cmp>;
     using edge_sorter_reverse_less_t    = stxxl::sorter<edge_t, edge_reverse_less_cmp>;
+    using forest_sorter_t               = stxxl::sorter<edge_t, edge_less_cmp>;
+
+    // sorters handing the relabelled edges over to the right subproblem
+    // form their runs and merge ahead of the consumer in background threads
+#ifdef SYNCHRONOUS_HANDOFFS
+    using handoff_sorter_less_t         = edge_sorter_less_t;
+    using handoff_sorter_reverse_less_t = edge_sorter_reverse_less_t;
+#else
+    using handoff_sorter_less_t         = AsyncSorter<edge_sorter_less_t>;
+    using handoff_sorter_reverse_less_t = AsyncSorter<edge_sorter_reverse_less_t>;
+#endif
 
     // component label stream types
-    using node_cc_sorter_node_cc_less_t = stxxl::sorter<node_component_t, node_component_node_cc_less_cmp>;
+    // base cases emit their components presorted into these
+    using node_cc_sorter_node_cc_less_t = PresortedSorter<node_component_t, node_component_node_cc_less_cmp>;
     using node_cc_sorter_cc_node_less_t = stxxl::sorter<node_component_t, node_component_cc_node_less_cmp>;
-    using cc_node_less_unique_type      = make_unique_stream<node_cc_sorter_node_cc_less_t>;
-    using unique_cc_stream_t            = make_unique_stream<stxxl::sorter<node_component_t, node_component_node_cc_less_cmp>>;
+    // the component maps of the levels only take a sorter from the pool while they hold components
+    using level_ccs_pool_t              = SorterPool<node_cc_sorter_node_cc_less_t>;
+    using level_ccs_sorter_t            = PooledSorter<node_cc_sorter_node_cc_less_t>;
+    using unique_cc_stream_t            = make_unique_stream<level_ccs_sorter_t>;
+
+    // a left and a right component map are recycled for the next level
+    static constexpr size_t LEVEL_CCS_IDLE_SORTERS = 2;
+
+    // every sample class beyond the first keeps an edge stream open until it is solved
+    static constexpr unsigned MAX_SAMPLE_CLASSES = 8;
+
+    // the edge blocks queued for the workers of a base case take at most this fraction of main memory
+    static constexpr size_t BASECASE_QUEUE_SHARE = 4;
+
+public:
+    // relative error tolerated by the node bounds taken from distinct element sketches
+    static constexpr double DEFAULT_SKETCH_ERROR = 0.05;
+    // the sketch bounds hold unless the estimate is off by this many standard errors
+    static constexpr double SKETCH_CONFIDENCE = 3.0;
 
 private:
     EdgesIn& edges;
     const size_t num_edges;
     const node_t num_nodes;
     const size_t main_memory_size;
+    // worker threads of the base case, the memory of their edge blocks and the main memory left for the union-find
+    const size_t basecase_threads;
+    const size_t basecase_queue_size;
+    const size_t basecase_memory_size;
 
     // data structures for the algorithm
     std::mt19937_64 gen;
     std::vector<std::unique_ptr<edge_sequence_t>> sub_edges_levels;
-    std::vector<std::unique_ptr<node_cc_sorter_node_cc_less_t>> ccs_left;
-    std::vector<std::unique_ptr<node_cc_sorter_node_cc_less_t>> ccs_right;
+    level_ccs_pool_t ccs_pool;
+    std::vector<std::unique_ptr<level_ccs_sorter_t>> ccs_left;
+    std::vector<std::unique_ptr<level_ccs_sorter_t>> ccs_right;
     std::unique_ptr<unique_cc_stream_t> output_ccs;
     size_t level = 0;
     size_t latest_max_level = 0;
-    size_t used_main_memory_size = 0;
+    // memory of the forest sorters kept per level, see new_level_sorter
+    MemoryReservation level_sorters_reservation;
     node_component_t last_output{MAX_NODE, MAX_NODE};
     policy_t& policy;
 
+    // spanning forests (normalized edges) per level like the component maps, only if requested
+    const bool compute_forest;
+    const size_t memory_overhead_factor;
+    // 0 keeps the counting bounds of the sampling scan only
+    const double sketch_error;
+    std::vector<std::unique_ptr<forest_sorter_t>> forests_left;
+    std::vector<std::unique_ptr<forest_sorter_t>> forests_right;
+
+    // subproblem whose phases are recorded, see process
+    struct subproblem_t {
+        size_t level;
+        bool left;
+    };
+    subproblem_t current_subproblem{0, true};
+
 public:
+    using value_type = node_component_t;
+
     FunctionalSubproblemManager() = delete;
 
-    FunctionalSubproblemManager(EdgesIn& edges, size_t main_memory_size, node_t num_nodes, policy_t& policy, unsigned seed = std::random_device()())
+    FunctionalSubproblemManager(EdgesIn& edges, size_t main_memory_size, node_t num_nodes, policy_t& policy, unsigned seed = std::random_device()(),
+                                bool compute_forest = false, double sketch_error = DEFAULT_SKETCH_ERROR,
+                                size_t basecase_threads = std::thread::hardware_concurrency())
 	: edges(edges),
       num_edges(edges.size()),
       num_nodes(num_nodes),
       main_memory_size(main_memory_size),
+      basecase_threads(std::max<size_t>(basecase_threads, 1)),
+      basecase_queue_size(std::min(ParallelKruskal::QUEUE_MEM, main_memory_size / BASECASE_QUEUE_SHARE)),
+      basecase_memory_size(main_memory_size - std::min(main_memory_size, stream_kruskal_t::buffer_bytes(this->basecase_threads, basecase_queue_size))),
       gen(seed),
       sub_edges_levels(),
-      policy(policy)
+      ccs_pool(node_component_node_cc_less_cmp(), MemoryBudget::instance().level_sorter_mem(), LEVEL_CCS_IDLE_SORTERS),
+      policy(policy),
+      compute_forest(compute_forest),
+      memory_overhead_factor(stream_kruskal_t::MEMORY_OVERHEAD_FACTOR + (compute_forest ? stream_kruskal_t::FOREST_OVERHEAD_FACTOR : 0)),
+      sketch_error(sketch_error)
     {
 	    std::cout << "Instantiated FunctionalSubproblemManager" << std::endl;
         sub_edges_levels.emplace_back(new edge_sequence_t());
         sub_edges_levels.emplace_back(new edge_sequence_t());
-        ccs_left.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
-        ccs_right.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
+        ccs_left.emplace_back(new level_ccs_sorter_t(ccs_pool));
+        ccs_right.emplace_back(new level_ccs_sorter_t(ccs_pool));
 
         process(edges, num_nodes, level, true);
         output_ccs = std::make_unique<unique_cc_stream_t>(*ccs_left[0]);
-
-        used_main_memory_size += 2*SORTER_MEM;
+        if (compute_forest) {
+            get_forest(true, 0).sort();
+        }
     }
 
     [[nodiscard]] bool empty() const {
@@ -137,6 +228,12 @@ public:
         output_ccs->rewind();
     }
 
+    //! Spanning forest of the input in ascending order; only computed if requested on construction
+    auto & forest() {
+        assert(compute_forest);
+        return get_forest(true, 0);
+    }
+
     // TODO Add assertions that everything is empty before destroying
     ~FunctionalSubproblemManager() {
         for (auto & sub_edges : sub_edges_levels) sub_edges.reset(nullptr);
@@ -147,14 +244,24 @@ public:
 private:
 
     template <typename InEdges, typename OutComponentsSorter>
-    std::pair<node_t, node_t> semi_external(InEdges& in_edges, OutComponentsSorter& ccs_out) {
+    std::pair<node_t, node_t> semi_external(InEdges& in_edges, OutComponentsSorter& ccs_out, node_t nodes_upp_bnd, forest_sorter_t* forest_out,
+                                            const char* branch = "") {
         foxxll_timer basecase_timer("Basecase");
+        const foxxll::stats_data basecase_stats_begin(*foxxll::stats::get_instance());
+        MemoryPhase basecase_phase(MemoryBudget::phase_t::basecase);
+        const size_t num_edges_in = in_edges.size();
 
         using in_edges_unique_type = make_unique_stream<InEdges>;
         in_edges_unique_type in_edges_uqe(in_edges);
-        StreamKruskal semiext_kruskal_algo;
+        auto semiext_kruskal_algo = new_basecase<stream_kruskal_t>();
+        const node_t nodes_estimate = basecase_nodes_estimate(nodes_upp_bnd, in_edges.size());
+        semiext_kruskal_algo.reserve(nodes_estimate);
+        if (forest_out) semiext_kruskal_algo.keep_forest();
         semiext_kruskal_algo.process(ccs_out, in_edges_uqe);
         ccs_out.sort_reuse();
+        if (forest_out) semiext_kruskal_algo.process_forest(*forest_out);
+        log_estimate_exceeded(semiext_kruskal_algo.get_num_nodes(), nodes_estimate);
+        record_phase("basecase", branch, nodes_upp_bnd, num_edges_in, semiext_kruskal_algo.get_num_ccs(), 0, basecase_stats_begin, semiext_kruskal_algo.get_num_nodes());
 
         assert(in_edges_uqe.empty());
 
@@ -162,15 +269,25 @@ private:
     }
 
     template <typename InEdges, typename OutComponentsSorter>
-    std::pair<node_t, node_t> semi_external(InEdges& in_edges_left, InEdges& in_edges_right, OutComponentsSorter& ccs_out) {
+    std::pair<node_t, node_t> semi_external(InEdges& in_edges_left, InEdges& in_edges_right, OutComponentsSorter& ccs_out, node_t nodes_upp_bnd, forest_sorter_t* forest_out,
+                                            const char* branch = "") {
         foxxll_timer basecase_timer("Basecase");
+        const foxxll::stats_data basecase_stats_begin(*foxxll::stats::get_instance());
+        MemoryPhase basecase_phase(MemoryBudget::phase_t::basecase);
+        const size_t num_edges_in = in_edges_left.size() + in_edges_right.size();
 
         using in_edges_unique_type = make_unique_stream<InEdges>;
         in_edges_unique_type in_edges_left_uqe(in_edges_left);
         in_edges_unique_type in_edges_right_uqe(in_edges_right);
-        StreamKruskal semiext_kruskal_algo;
+        auto semiext_kruskal_algo = new_basecase<stream_kruskal_t>();
+        const node_t nodes_estimate = basecase_nodes_estimate(nodes_upp_bnd, num_edges_in);
+        semiext_kruskal_algo.reserve(nodes_estimate);
+        if (forest_out) semiext_kruskal_algo.keep_forest();
         semiext_kruskal_algo.process(ccs_out, in_edges_left_uqe, in_edges_right_uqe);
         ccs_out.sort_reuse();
+        if (forest_out) semiext_kruskal_algo.process_forest(*forest_out);
+        log_estimate_exceeded(semiext_kruskal_algo.get_num_nodes(), nodes_estimate);
+        record_phase("basecase", branch, nodes_upp_bnd, num_edges_in, semiext_kruskal_algo.get_num_ccs(), 0, basecase_stats_begin, semiext_kruskal_algo.get_num_nodes());
 
         assert(in_edges_left_uqe.empty());
         assert(in_edges_right_uqe.empty());
@@ -178,7 +295,37 @@ private:
         return std::make_pair(semiext_kruskal_algo.get_num_nodes(), semiext_kruskal_algo.get_num_ccs());
     }
 
-    node_t relabel_right_edges(size_t current_level, node_cc_sorter_cc_node_less_t& ccs_G_ip1_left_srtd_cc_node_less, edge_sorter_less_t& edges_G_ip1_right_over_left) {
+    // base case over all sample classes of G_i, the first class being the left edges of the next level
+    template <typename OutComponentsSorter>
+    std::pair<node_t, node_t> semi_external(std::vector<std::unique_ptr<edge_sequence_t>>& later_classes, size_t current_level,
+                                            OutComponentsSorter& ccs_out, node_t nodes_upp_bnd, const char* branch) {
+        foxxll_timer basecase_timer("Basecase");
+        const foxxll::stats_data basecase_stats_begin(*foxxll::stats::get_instance());
+        MemoryPhase basecase_phase(MemoryBudget::phase_t::basecase);
+
+        auto & edges_first_class = *sub_edges_levels[current_level + 1];
+        size_t num_edges_G_i = edges_first_class.size();
+        for (const auto & later_class : later_classes) num_edges_G_i += later_class->size();
+
+        // the classes partition the unique edges of G_i
+        auto semiext_kruskal_algo = new_basecase<pipelined_kruskal_t>();
+        const node_t nodes_estimate = basecase_nodes_estimate(nodes_upp_bnd, num_edges_G_i);
+        semiext_kruskal_algo.reserve(nodes_estimate);
+        StreamPusher(edges_first_class, semiext_kruskal_algo);
+        for (auto & later_class : later_classes) StreamPusher(*later_class, semiext_kruskal_algo);
+        semiext_kruskal_algo.process(ccs_out);
+        ccs_out.sort_reuse();
+        log_estimate_exceeded(semiext_kruskal_algo.get_num_nodes(), nodes_estimate);
+        record_phase("basecase", branch, nodes_upp_bnd, num_edges_G_i, semiext_kruskal_algo.get_num_ccs(), 0, basecase_stats_begin, semiext_kruskal_algo.get_num_nodes());
+
+        reset_edges(current_level + 1);
+        later_classes.clear();
+
+        return std::make_pair(semiext_kruskal_algo.get_num_nodes(), semiext_kruskal_algo.get_num_ccs());
+    }
+
+    node_t relabel_right_edges(size_t current_level, node_cc_sorter_cc_node_less_t& ccs_G_ip1_left_srtd_cc_node_less, handoff_sorter_less_t& edges_G_ip1_right_over_left,
+                               const char*& branch) {
         node_t node_upp_bnd_G_ip1_right_relabel = 0;
 
         // retrieve edges of right subcall
@@ -186,51 +333,58 @@ private:
 
         // use components of left subcall
         auto & ccs_G_ip1_left    = *ccs_left[current_level + 1];
-        make_unique_stream<node_cc_sorter_node_cc_less_t> ccs_G_ip1_left_uqe(ccs_G_ip1_left);
 
         // reset
         reset_edges(current_level + 1);
 
         //!! update right subproblem with ccs of left subproblem, save ccs of left but sorted by comp
         foxxll_timer relabelling_timer("Relabelling");
+        MemoryPhase relabelling_phase(MemoryBudget::phase_t::relabelling);
         std::cout << "Relabelling Sources (Components Left: " << ccs_G_ip1_left.size() << ")"
                   << " to (Edges: " << edges_G_ip1_right.size() << ")" << std::endl;
 
+#ifndef TWO_PASS_RELABELLING
+        // update sources and targets at once, the base case memory is not in use meanwhile
+        std::cout << "  updating sources and targets" << std::endl;
+        FusedEdgeRelabeller relabeller(ccs_G_ip1_left, ccs_G_ip1_left_srtd_cc_node_less, edges_G_ip1_right, edges_G_ip1_right_over_left, main_memory_size);
+        if (relabeller.semi_external()) std::cout << "  [OPTIMIZATION] Semi-External Label Lookup" << std::endl;
+        branch = (relabeller.semi_external() ? "semi_external_lookup" : "time_forward");
+
+        // no longer need non-updated edges
+        release_right_edges(current_level);
+        node_upp_bnd_G_ip1_right_relabel = relabeller.node_upp_bnd();
+#else
+        branch = "two_pass";
+
         // update sources first
         std::cout << "  updating sources" << std::endl;
-        edge_sorter_reverse_less_t edges_G_ip1_right_upsrc(edge_reverse_less_cmp(), SORTER_MEM);
-        node_t last_src_G_ip1{MAX_NODE};
+        make_unique_stream<level_ccs_sorter_t> ccs_G_ip1_left_uqe(ccs_G_ip1_left);
+        handoff_sorter_reverse_less_t edges_G_ip1_right_upsrc(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
         for (; !ccs_G_ip1_left_uqe.empty(); ++ccs_G_ip1_left_uqe) {
             const auto node_cc_G_i_left = *ccs_G_ip1_left_uqe;
             ccs_G_ip1_left_srtd_cc_node_less.push(node_cc_G_i_left);
-            for (; !edges_G_ip1_right.empty(); ++edges_G_ip1_right) {
+
+            // sources without a component are passed through run by run
+            node_upp_bnd_G_ip1_right_relabel += forward_sources_below(edges_G_ip1_right, node_cc_G_i_left.node, edges_G_ip1_right_upsrc);
+
+            bool has_edges = false;
+            for (; !edges_G_ip1_right.empty() && (*edges_G_ip1_right).u == node_cc_G_i_left.node; ++edges_G_ip1_right) {
                 const auto edge_G_ip1_right = *edges_G_ip1_right;
-                node_upp_bnd_G_ip1_right_relabel += (last_src_G_ip1 != edge_G_ip1_right.u);
-                last_src_G_ip1 = edge_G_ip1_right.u;
-                if (edge_G_ip1_right.u < node_cc_G_i_left.node) {
-                    assert(edge_G_ip1_right.u != edge_G_ip1_right.v);
-                    edges_G_ip1_right_upsrc.push(edge_G_ip1_right);
-                } else if (edge_G_ip1_right.u == node_cc_G_i_left.node) {
-                    // skip self-loop
-                    if (node_cc_G_i_left.load == edge_G_ip1_right.v) continue;
-                    edges_G_ip1_right_upsrc.push(edge_t{node_cc_G_i_left.load, edge_G_ip1_right.v});
-                } else
-                    break;
+                has_edges = true;
+                // skip self-loop
+                if (node_cc_G_i_left.load == edge_G_ip1_right.v) continue;
+                edges_G_ip1_right_upsrc.push(edge_t{node_cc_G_i_left.load, edge_G_ip1_right.v});
             }
+            node_upp_bnd_G_ip1_right_relabel += has_edges;
         }
 
         // flush edges
         std::cout << "  flushing remaining edges" << std::endl;
-        for (; !edges_G_ip1_right.empty(); ++edges_G_ip1_right) {
-            const auto edge_G_ip1_right = *edges_G_ip1_right;
-            node_upp_bnd_G_ip1_right_relabel += (last_src_G_ip1 != edge_G_ip1_right.u);
-            last_src_G_ip1 = edge_G_ip1_right.u;
-            edges_G_ip1_right_upsrc.push(edge_G_ip1_right);
-        }
+        node_upp_bnd_G_ip1_right_relabel += forward_sources_below(edges_G_ip1_right, MAX_NODE, edges_G_ip1_right_upsrc);
 
         // no longer need non-updated edges
         assert(edges_G_ip1_right.empty());
-        reset_edges(current_level);
+        release_right_edges(current_level);
 
         // sort source updated edges
         std::cout << "  sorting source updated edges" << std::endl;
@@ -287,6 +441,7 @@ private:
         // no longer need only-source-updated edges
         assert(edges_G_ip1_right_upsrc.empty());
         edges_G_ip1_right_upsrc.finish_clear();
+#endif
 
         // sort source and target relabelled edges
         std::cout << "  sorting source and target updated edges" << std::endl;
@@ -320,43 +475,80 @@ private:
             auto & ccs_G_ip1_right  = *ccs_right[current_level + 1];
 
             foxxll_timer relabelling_timer("Relabelling");
+            const foxxll::stats_data basecase_stats_begin(*foxxll::stats::get_instance());
+            const size_t num_edges_G_ip1_right = edges_G_ip1_right.size();
+
+            MemoryPhase relabelling_phase(MemoryBudget::phase_t::relabelling);
+
+#ifndef TWO_PASS_RELABELLING
+            // relabel sources and targets straight into the base case, whose union-find shares the memory with the labels
+            std::cout << "Relabelling (Components Left: " << ccs_G_ip1_left.size() << ") to (Edges: " << edges_G_ip1_right.size() << ")" << std::endl;
+            auto semiext_kruskal_algo = new_basecase<pipelined_kruskal_t>();
+            const node_t nodes_estimate = basecase_nodes_estimate(nodes_upp_bnd_contracted_G_ip1_right, edges_G_ip1_right.size());
+            semiext_kruskal_algo.reserve(nodes_estimate);
+            if (compute_forest) semiext_kruskal_algo.keep_forest();
+            const size_t basecase_mem = static_cast<size_t>(nodes_estimate) * sizeof(node_t) * memory_overhead_factor;
+            FusedEdgeRelabeller(ccs_G_ip1_left, ccs_G_ip1_left_srtd_cc_node_less, edges_G_ip1_right, semiext_kruskal_algo,
+                                basecase_memory_size - std::min(basecase_memory_size, basecase_mem));
+
+            // no longer need non-updated edges
+            assert(edges_G_ip1_right.empty());
+            release_right_edges(current_level);
 
+            // asserts and verification
+            assert(sub_edges_levels[current_level + 1]->size() == 0);
+            assert(compute_forest || sub_edges_levels[current_level]->size() == 0);
+#else
             // relabel sources
             std::cout << "Relabelling Sources (Components Left: " << ccs_G_ip1_left.size() << ") to (Edges: " << edges_G_ip1_right.size() << ")" << std::endl;
             std::cout << "  updating sources" << std::endl;
-            edge_sorter_reverse_less_t edges_G_ip1_right_upsrc(edge_reverse_less_cmp(), SORTER_MEM);
+            handoff_sorter_reverse_less_t edges_G_ip1_right_upsrc(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
             EdgeSorterSourceRelabeller(ccs_G_ip1_left, ccs_G_ip1_left_srtd_cc_node_less, edges_G_ip1_right, edges_G_ip1_right_upsrc);
 
             // no longer need non-updated edges
             assert(edges_G_ip1_right.empty());
-            reset_edges(current_level);
+            release_right_edges(current_level);
 
             std::cout << "  sorting source updated edges" << std::endl;
             edges_G_ip1_right_upsrc.sort_reuse();
 
             // asserts and verification
             assert(sub_edges_levels[current_level + 1]->size() == 0);
-            assert(sub_edges_levels[current_level]->size()     == 0);
+            assert(compute_forest || sub_edges_levels[current_level]->size() == 0);
 
             // relabel targets
             ccs_G_ip1_left.rewind();
             make_unique_stream<decltype(edges_G_ip1_right_upsrc)> edges_G_ip1_right_upsrc_uqe(edges_G_ip1_right_upsrc, edge_t{MAX_NODE, MAX_NODE});
-            PipelinedKruskal semiext_kruskal_algo;
+            auto semiext_kruskal_algo = new_basecase<pipelined_kruskal_t>();
+            const node_t nodes_estimate = basecase_nodes_estimate(nodes_upp_bnd_contracted_G_ip1_right, edges_G_ip1_right_upsrc.size());
+            semiext_kruskal_algo.reserve(nodes_estimate);
+            if (compute_forest) semiext_kruskal_algo.keep_forest();
             EdgeSorterTargetRelabeller(ccs_G_ip1_left, edges_G_ip1_right_upsrc_uqe, semiext_kruskal_algo);
 
             // no longer need only-source-updated edges
             assert(edges_G_ip1_right_upsrc.empty());
             edges_G_ip1_right_upsrc.finish_clear();
+#endif
 
             // compute connected components
             semiext_kruskal_algo.process(ccs_G_ip1_right);
             ccs_G_ip1_right.sort_reuse();
+            if (compute_forest) semiext_kruskal_algo.process_forest(get_forest(false, current_level + 1));
+            log_estimate_exceeded(semiext_kruskal_algo.get_num_nodes(), nodes_estimate);
+            record_phase("basecase", "combined_relabelling", nodes_upp_bnd_contracted_G_ip1_right, num_edges_G_ip1_right,
+                         semiext_kruskal_algo.get_num_ccs(), 0, basecase_stats_begin, semiext_kruskal_algo.get_num_nodes());
 
             return std::make_pair(semiext_kruskal_algo.get_num_nodes(), semiext_kruskal_algo.get_num_ccs());
         } else {
             //!! relabel left connected components into right edges
-            edge_sorter_less_t edges_G_ip1_right_over_left(edge_less_cmp(), SORTER_MEM);
-            const node_t node_upp_bnd_G_ip1_relabel = relabel_right_edges(current_level, ccs_G_ip1_left_srtd_cc_node_less, edges_G_ip1_right_over_left);
+            MemoryReservation edges_G_ip1_right_reservation;
+            handoff_sorter_less_t edges_G_ip1_right_over_left(edge_less_cmp(), reserve_sorter_mem(edges_G_ip1_right_reservation, current_level + 1));
+            const size_t num_edges_G_ip1_right = edges_G_ip1_right.size();
+            const foxxll::stats_data relabelling_stats_begin(*foxxll::stats::get_instance());
+            const char* relabelling_branch = "";
+            const node_t node_upp_bnd_G_ip1_relabel = relabel_right_edges(current_level, ccs_G_ip1_left_srtd_cc_node_less, edges_G_ip1_right_over_left, relabelling_branch);
+            report_phase(phase_feedback_t::phase_t::relabelling, current_level, nodes_upp_bnd_contracted_G_ip1_right, num_edges_G_ip1_right,
+                         node_upp_bnd_G_ip1_relabel, edges_G_ip1_right_over_left.size(), relabelling_stats_begin, 0, relabelling_branch);
 
             //!! solve right subproblem recursively
             const auto [nodes_G_ip1_right, num_ccs_G_ip1_right]
@@ -366,6 +558,54 @@ private:
         }
     }
 
+    /**
+     * Solves the sample classes of G_i in order: the first one like the left
+     * subproblem, every later one like a right subproblem relabelled with the
+     * components of the classes before it, whose map is then merged with its
+     * components. Most edges of a later class fall into the accumulated
+     * components and vanish as self-loops, so that every class but the first
+     * is mostly solved by the relabelling scan instead of further levels.
+     * Leaves the component map of G_i in ccs_left[current_level + 1].
+     *
+     * @return Pair of number of nodes and upper bound on the connected components of G_i
+     */
+    std::pair<node_t, node_t> process_sample_classes(size_t current_level, bool left, node_t nodes_upp_bnd_G_i,
+                                                     const std::vector<node_t>& nodes_upp_bnd_classes,
+                                                     std::vector<std::unique_ptr<edge_sequence_t>>& later_classes) {
+        auto [nodes_acc, num_ccs_acc] = process_left(current_level, std::min(nodes_upp_bnd_G_i, nodes_upp_bnd_classes[0]));
+
+        // asserts and verification
+        assert(sub_edges_levels[current_level + 1]->size() == 0);
+
+        for (size_t i = 1; i < nodes_upp_bnd_classes.size(); ++i) {
+            std::cout << "Sample class " << i << " (Components so far: " << num_ccs_acc << ")" << std::endl;
+
+            // the class takes the place of the right edges
+            sub_edges_levels[current_level]->swap(*later_classes[i - 1]);
+            later_classes[i - 1].reset(nullptr);
+
+            // its nodes are either unseen or relabelled to one of the components so far
+            const node_t nodes_upp_bnd_class
+            = std::min(std::min(nodes_upp_bnd_classes[i], nodes_upp_bnd_G_i), nodes_upp_bnd_G_i - nodes_acc + num_ccs_acc);
+
+            MemoryReservation ccs_acc_reservation;
+            node_cc_sorter_cc_node_less_t ccs_acc_srtd_cc_node_less(node_component_cc_node_less_cmp(), reserve_sorter_mem(ccs_acc_reservation, current_level + 1));
+            const auto [nodes_class, num_ccs_class] = process_right(current_level, nodes_upp_bnd_class, ccs_acc_srtd_cc_node_less);
+            tlx::unused(nodes_class);
+
+            // asserts and verification
+            assert(sub_edges_levels[current_level]->size() == 0);
+
+            // the merged map accumulates the components for the next class
+            merge_left_right_ccs(current_level, left, ccs_acc_srtd_cc_node_less);
+            ccs_left[current_level + 1].swap(left ? ccs_left[current_level] : ccs_right[current_level]);
+            nodes_acc = ccs_left[current_level + 1]->size();
+            num_ccs_acc += num_ccs_class;
+        }
+
+        return std::make_pair(nodes_acc, num_ccs_acc);
+    }
+
     /**
      *
      * @param current_level
@@ -375,11 +615,15 @@ private:
     void merge_left_right_ccs(size_t current_level, bool left, node_cc_sorter_cc_node_less_t& ccs_G_ip1_left_srtd_cc_node_less) {
         //!! merge ccs from left and right recursion
         foxxll_timer merging_timer("Merging");
+        MemoryPhase merging_phase(MemoryBudget::phase_t::merging);
 
         auto & ccs_G_ip1_left  = *ccs_left[current_level + 1];
         auto & ccs_G_ip1_right = *ccs_right[current_level + 1];
         auto & ccs_G_i         = get_component_map(left, current_level);
 
+        const foxxll::stats_data merging_stats_begin(*foxxll::stats::get_instance());
+        const size_t num_labels_in = ccs_G_ip1_left_srtd_cc_node_less.size() + ccs_G_ip1_right.size();
+
         // merge left and right
         std::cout << "  sorting left connected components by component" << std::endl;
         ccs_G_ip1_left_srtd_cc_node_less.sort_reuse();
@@ -397,6 +641,7 @@ private:
         // sort
         std::cout << "  sorting merged component map" << std::endl;
         ccs_G_i.sort_reuse();
+        record_phase("merging", "", num_labels_in, 0, ccs_G_i.size(), 0, merging_stats_begin);
     }
 
     /**
@@ -406,9 +651,14 @@ private:
      * @param current_level
      * @param left
      */
-    void merge_ccs_over_ccs(node_cc_sorter_cc_node_less_t& node_contraction_G_i, node_cc_sorter_node_cc_less_t& ccs_contracted_G_i, size_t current_level, bool left) {
+    template <typename ContractedComponentsSorter>
+    void merge_ccs_over_ccs(node_cc_sorter_cc_node_less_t& node_contraction_G_i, ContractedComponentsSorter& ccs_contracted_G_i, size_t current_level, bool left) {
         //!! merge ccs from left and right recursion
         foxxll_timer merging_timer("Merging");
+        MemoryPhase merging_phase(MemoryBudget::phase_t::merging);
+
+        const foxxll::stats_data merging_stats_begin(*foxxll::stats::get_instance());
+        const size_t num_labels_in = node_contraction_G_i.size() + ccs_contracted_G_i.size();
 
         // compute merge
         std::cout << "  merging" << std::endl;
@@ -424,11 +674,12 @@ private:
         // sort
         std::cout << "  sorting merged component map" << std::endl;
         ccs_G_i.sort_reuse();
+        record_phase("merging", "", num_labels_in, 0, ccs_G_i.size(), 0, merging_stats_begin);
     }
 
     template <typename InEdges>
     std::pair<node_t, node_t> fully_external(InEdges & in_edges, node_t nodes_upp_bnd, size_t current_level, bool left) {
-        const auto nodes_upp_bnd_2 = std::min(nodes_upp_bnd, in_edges.size() * 2);
+        const node_t nodes_upp_bnd_2 = std::min<size_t>(nodes_upp_bnd, in_edges.size() * 2);
 
         std::cout << "External case" << std::endl;
         std::cout << "Level " << current_level << std::endl;
@@ -446,34 +697,47 @@ private:
         }
 
         make_unique_stream<InEdges> in_edges_uqe(in_edges);
+        const size_t num_edges_G_i = in_edges.size();
 
         //!! contract edges using star
-        bool perform_contraction = policy.perform_contraction(nodes_upp_bnd_2, in_edges.size(), current_level, main_memory_size / (sizeof(node_t) * StreamKruskal::MEMORY_OVERHEAD_FACTOR));
+        bool perform_contraction = policy.perform_contraction(nodes_upp_bnd_2, in_edges.size(), current_level, basecase_memory_size / (sizeof(node_t) * memory_overhead_factor));
         std::cout << "Ask policy: contract? " << perform_contraction << std::endl;
+        if (perform_contraction && compute_forest && !Contraction::supports_forest()) {
+            std::cout << "Contraction yields no forest, skipping it" << std::endl;
+            perform_contraction = false;
+        }
         node_t nodes_upp_bnd_contracted_G_i_con;
 
         if (perform_contraction) {
             foxxll::stats *contraction_stats = foxxll::stats::get_instance();
             foxxll::stats_data contraction_stats_begin(*contraction_stats);
 
-            node_cc_sorter_cc_node_less_t node_contraction_G_i(node_component_cc_node_less_cmp(), SORTER_MEM);
-            edge_sorter_less_t contracted_edges_G_i(edge_less_cmp(), SORTER_MEM);
+            // both outlive the contraction phase
+            MemoryReservation contraction_reservation;
+            node_cc_sorter_cc_node_less_t node_contraction_G_i(node_component_cc_node_less_cmp(), reserve_sorter_mem(contraction_reservation, current_level));
+            edge_sorter_less_t contracted_edges_G_i(edge_less_cmp(), reserve_sorter_mem(contraction_reservation, current_level));
             Contraction contraction_algo;
 
-            size_t contraction_goal = policy.contract_number(nodes_upp_bnd_2, in_edges.size(), current_level, main_memory_size / (sizeof(node_t) * StreamKruskal::MEMORY_OVERHEAD_FACTOR));
+            size_t contraction_goal = policy.contract_number(nodes_upp_bnd_2, in_edges.size(), current_level, basecase_memory_size / (sizeof(node_t) * memory_overhead_factor));
             std::cout << "Will contract " << contraction_goal << " nodes" << std::endl;
             // NOTE: now dependent on contraction goal; no longer supporting expected contraction ratio
-            if (is_semi_externally_handleable(nodes_upp_bnd_2 - contraction_goal) && Contraction::supports_only_map_return()) {
+            if (is_semi_externally_handleable(nodes_upp_bnd_2 - contraction_goal) && Contraction::supports_only_map_return() && !compute_forest) {
                 std::cout << "[OPTIMIZATION] Pipe Contraction into pipelined Kruskal immediately" << std::endl;
 
-                PipelinedKruskal semiext_kruskal_algo;
-                contraction_algo.compute_semi_external_contraction(in_edges_uqe, node_contraction_G_i, semiext_kruskal_algo, contraction_goal);
+                auto semiext_kruskal_algo = new_basecase<pipelined_kruskal_t>();
+                semiext_kruskal_algo.reserve(basecase_nodes_estimate(nodes_upp_bnd_2 - contraction_goal, in_edges.size()));
+                {
+                    MemoryPhase contraction_phase(MemoryBudget::phase_t::contraction);
+                    contraction_algo.compute_semi_external_contraction(in_edges_uqe, node_contraction_G_i, semiext_kruskal_algo, contraction_goal);
+                }
                 node_contraction_G_i.sort_reuse();
                 const node_t node_contraction_G_i_size = node_contraction_G_i.size();
 
-                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), SORTER_MEM);
+                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
                 semiext_kruskal_algo.process(ccs_contracted_G_i);
                 ccs_contracted_G_i.sort_reuse();
+                record_phase("contraction", "pipelined_basecase", nodes_upp_bnd_2, num_edges_G_i, semiext_kruskal_algo.get_num_ccs(), 0,
+                             contraction_stats_begin, semiext_kruskal_algo.get_num_nodes() + node_contraction_G_i_size);
 
                 // remap node contraction to returned connected components from the base case
                 merge_ccs_over_ccs(node_contraction_G_i, ccs_contracted_G_i, current_level, left);
@@ -486,7 +750,23 @@ private:
                 return std::make_pair(semiext_kruskal_algo.get_num_nodes() + node_contraction_G_i_size, semiext_kruskal_algo.get_num_ccs());
             }
 
-            contraction_algo.compute_fully_external_contraction(in_edges_uqe, contracted_edges_G_i, node_contraction_G_i, contraction_goal);
+            // for the forest, the contraction yields the edges within contracted groups and
+            // the forest of the contracted graph is lifted back onto a copy of the input
+            std::unique_ptr<edge_sequence_t> edges_G_i;
+            std::unique_ptr<forest_sorter_t> forest_contracted_G_i;
+            if (compute_forest) {
+                if constexpr (Contraction::supports_forest()) {
+                    edges_G_i = std::make_unique<edge_sequence_t>();
+                    StreamPusher(in_edges_uqe, *edges_G_i);
+                    in_edges_uqe.rewind();
+                    forest_contracted_G_i = std::make_unique<forest_sorter_t>(edge_less_cmp(), reserve_sorter_mem(contraction_reservation, current_level));
+                    MemoryPhase contraction_phase(MemoryBudget::phase_t::contraction);
+                    contraction_algo.compute_fully_external_contraction(in_edges_uqe, contracted_edges_G_i, node_contraction_G_i, get_forest(left, current_level), contraction_goal);
+                }
+            } else {
+                MemoryPhase contraction_phase(MemoryBudget::phase_t::contraction);
+                contraction_algo.compute_fully_external_contraction(in_edges_uqe, contracted_edges_G_i, node_contraction_G_i, contraction_goal);
+            }
             in_edges.clear();
             contracted_edges_G_i.sort_reuse();
             node_contraction_G_i.sort_reuse();
@@ -501,6 +781,8 @@ private:
             std::cout << "m' ≤ " << contracted_edges_G_i.size() << std::endl;
 
             std::cout << "Contracting: " << (foxxll::stats_data(*contraction_stats) - contraction_stats_begin).get_elapsed_time() << std::endl;
+            report_phase(phase_feedback_t::phase_t::contraction, current_level, nodes_upp_bnd_2, num_edges_G_i,
+                         nodes_ub_G_i_con_goal, contracted_edges_G_i.size(), contraction_stats_begin);
 
             // if the contraction removed all edges
             if (contracted_edges_G_i.size() == 0 || contracted_edges_G_i.empty()) {
@@ -508,6 +790,9 @@ private:
 
                 //!! merge ccs from left and right recursion
                 foxxll_timer merging_timer("Merging");
+                const foxxll::stats_data merging_stats_begin(*foxxll::stats::get_instance());
+                MemoryPhase merging_phase(MemoryBudget::phase_t::merging);
+                const size_t num_labels_in = node_contraction_G_i.size();
 
                 // compute merge
                 auto & ccs_G_i = get_component_map(left, current_level);
@@ -519,6 +804,7 @@ private:
                 // sort
                 std::cout << "  resorting merged component map" << std::endl;
                 ccs_G_i.sort_reuse();
+                record_phase("merging", "after_contraction_immediate_return", num_labels_in, 0, ccs_G_i.size(), 0, merging_stats_begin);
 
                 // clear lower recursion level
                 validate_depth(current_level + 1);
@@ -532,8 +818,10 @@ private:
             if (is_semi_externally_handleable(nodes_upp_bnd_contracted_G_i_con, contracted_edges_G_i)) {
                 std::cout << "[OPTIMIZATION] After Contraction Immediate Semi-Ext" << std::endl;
 
-                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), SORTER_MEM);
-                const auto [nodes_G_i, num_ccs_G_i] = semi_external(contracted_edges_G_i, ccs_contracted_G_i);
+                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
+                const auto [nodes_G_i, num_ccs_G_i] = semi_external(contracted_edges_G_i, ccs_contracted_G_i, nodes_upp_bnd_contracted_G_i_con, forest_contracted_G_i.get(),
+                                                                    "after_contraction_semi_external");
+                if (compute_forest) lift_contracted_forest(node_contraction_G_i, *edges_G_i, *forest_contracted_G_i, get_forest(left, current_level));
 
                 // remap node contraction to returned connected components from the base case
                 merge_ccs_over_ccs(node_contraction_G_i, ccs_contracted_G_i, current_level, left);
@@ -551,12 +839,50 @@ private:
             make_unique_stream<decltype(contracted_edges_G_i)> contracted_edges_G_i_uqe(contracted_edges_G_i, edge_t{MAX_NODE, MAX_NODE});
             std::cout << "Node upper bound before sampling: " << nodes_upp_bnd_contracted_G_i_con << std::endl;
             std::cout << "Number of edges before sampling: " << contracted_edges_G_i_uqe.size() << std::endl;
-            int sampling_prob_power = policy.sample_prob_power(nodes_upp_bnd_contracted_G_i_con, contracted_edges_G_i_uqe.size(), current_level, main_memory_size / (sizeof(node_t) * StreamKruskal::MEMORY_OVERHEAD_FACTOR));
+            const size_t num_edges_contracted_G_i = contracted_edges_G_i_uqe.size();
+            int sampling_prob_power = policy.sample_prob_power(nodes_upp_bnd_contracted_G_i_con, num_edges_contracted_G_i, current_level, basecase_memory_size / (sizeof(node_t) * memory_overhead_factor));
+            const foxxll::stats_data sampling_stats_begin(*foxxll::stats::get_instance());
+
+            const unsigned num_sample_classes = sample_classes(nodes_upp_bnd_contracted_G_i_con, num_edges_contracted_G_i, current_level);
+            if (num_sample_classes > 2) {
+                std::vector<std::unique_ptr<edge_sequence_t>> later_classes;
+                const auto [nodes_upp_bnd_contracted_G_i_sam, nodes_upp_bnd_classes_sam]
+                = split_edges(contracted_edges_G_i_uqe, current_level, sampling_prob_power, num_sample_classes, later_classes);
+                report_phase(phase_feedback_t::phase_t::sampling, current_level, nodes_upp_bnd_contracted_G_i_con, num_edges_contracted_G_i,
+                             nodes_upp_bnd_classes_sam[0], sub_edges_levels[current_level + 1]->size(), sampling_stats_begin, sampling_prob_power, "sample_classes");
+                const node_t nodes_upp_bnd_contracted_G_i = std::min(nodes_upp_bnd_contracted_G_i_sam, nodes_upp_bnd_contracted_G_i_con);
+
+                // contracted G_i no longer needed
+                contracted_edges_G_i.finish_clear();
+
+                //!! solve the classes and merge with the contraction
+                node_t num_ccs_contracted_G_i;
+                if (is_semi_externally_handleable(nodes_upp_bnd_contracted_G_i_sam)) {
+                    std::cout << "[OPTIMIZATION] After Sampling Estimates Fit Semi-Ext" << std::endl;
+                    node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
+                    num_ccs_contracted_G_i = semi_external(later_classes, current_level, ccs_contracted_G_i, nodes_upp_bnd_contracted_G_i,
+                                                           "after_sampling_semi_external").second;
+                    merge_ccs_over_ccs(node_contraction_G_i, ccs_contracted_G_i, current_level, left);
+                } else {
+                    num_ccs_contracted_G_i = process_sample_classes(current_level, left, nodes_upp_bnd_contracted_G_i, nodes_upp_bnd_classes_sam, later_classes).second;
+                    merge_ccs_over_ccs(node_contraction_G_i, *ccs_left[current_level + 1], current_level, left);
+                }
+
+                // clear lower recursion level
+                validate_depth(current_level + 1);
+                ccs_left [current_level + 1]->clear();
+                ccs_right[current_level + 1]->clear();
+
+                return std::make_pair(get_component_map(left, current_level).size(), num_ccs_contracted_G_i);
+            }
+
             const auto [nodes_upp_bnd_contracted_G_i_sam,
                         nodes_upp_bnd_contracted_G_ip1_left_sam,
                         nodes_upp_bnd_contracted_G_ip1_right_sam,
                         nodes_low_bnd_contracted_G_ip1_common_sam]
 	        = sample_edges(contracted_edges_G_i_uqe, current_level, true, sampling_prob_power);
+            report_phase(phase_feedback_t::phase_t::sampling, current_level, nodes_upp_bnd_contracted_G_i_con, num_edges_contracted_G_i,
+                         nodes_upp_bnd_contracted_G_ip1_left_sam, sub_edges_levels[current_level + 1]->size(), sampling_stats_begin, sampling_prob_power);
 
             // compute node upper bounds
             node_t nodes_upp_bnd_contracted_G_i         = std::min(nodes_upp_bnd_contracted_G_i_sam, nodes_upp_bnd_contracted_G_i_con);
@@ -578,10 +904,12 @@ private:
                 auto & edges_G_ip1_left   = *sub_edges_levels[current_level + 1];
                 auto & edges_G_ip1_right  = *sub_edges_levels[current_level];
 
-                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), SORTER_MEM);
-                const auto [nodes_G_i, num_ccs_G_i] = semi_external(edges_G_ip1_left, edges_G_ip1_right, ccs_contracted_G_i);
+                node_cc_sorter_node_cc_less_t ccs_contracted_G_i(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
+                const auto [nodes_G_i, num_ccs_G_i] = semi_external(edges_G_ip1_left, edges_G_ip1_right, ccs_contracted_G_i, nodes_upp_bnd_contracted_G_i, forest_contracted_G_i.get(),
+                                                                    "after_sampling_semi_external");
                 reset_edges(current_level);
                 reset_edges(current_level + 1);
+                if (compute_forest) lift_contracted_forest(node_contraction_G_i, *edges_G_i, *forest_contracted_G_i, get_forest(left, current_level));
 
                 merge_ccs_over_ccs(node_contraction_G_i, ccs_contracted_G_i, current_level, left);
 
@@ -595,7 +923,8 @@ private:
 
             //!! process left
             // compute connected components of sampled edges
-            node_cc_sorter_cc_node_less_t ccs_G_ip1_left_srtd_cc_node_less(node_component_cc_node_less_cmp(), SORTER_MEM);
+            MemoryReservation ccs_G_ip1_left_reservation;
+            node_cc_sorter_cc_node_less_t ccs_G_ip1_left_srtd_cc_node_less(node_component_cc_node_less_cmp(), reserve_sorter_mem(ccs_G_ip1_left_reservation, current_level + 1));
             const auto [nodes_G_ip1_left, num_ccs_G_ip1_left]
             = process_left(current_level, nodes_upp_bnd_contracted_G_ip1_left);
 
@@ -606,7 +935,7 @@ private:
             nodes_upp_bnd_contracted_G_ip1_right
             = std::min(std::min(nodes_upp_bnd_contracted_G_ip1_right,
                        nodes_upp_bnd_contracted_G_ip1_right - nodes_low_bnd_contracted_G_ip1_common_sam + num_ccs_G_ip1_left),
-                       nodes_upp_bnd_contracted_G_i - nodes_G_ip1_left + num_ccs_G_ip1_left);
+                       nodes_bound_after_left(nodes_upp_bnd_contracted_G_i, nodes_G_ip1_left, num_ccs_G_ip1_left));
 
             //!! process right
             // compute connected components of unsampled edges
@@ -614,6 +943,11 @@ private:
             = process_right(current_level, nodes_upp_bnd_contracted_G_ip1_right, ccs_G_ip1_left_srtd_cc_node_less);
             tlx::unused(nodes_G_ip1_right);
 
+            if (compute_forest) {
+                collect_forest(current_level, *forest_contracted_G_i);
+                lift_contracted_forest(node_contraction_G_i, *edges_G_i, *forest_contracted_G_i, get_forest(left, current_level));
+            }
+
             // asserts and verification
             assert(sub_edges_levels[current_level]->size() == 0);
             assert(ccs_left[current_level + 1]->empty());
@@ -621,13 +955,15 @@ private:
             //!! merge ccs from left and right recursion and the contraction
             foxxll::stats *merging_stats = foxxll::stats::get_instance();
             foxxll::stats_data merging_stats_begin(*merging_stats);
+            MemoryPhase merging_phase(MemoryBudget::phase_t::merging);
             auto & ccs_G_i = get_component_map(left, current_level);
 
             // prepare components of right subcall
             auto & ccs_G_ip1_right   = *ccs_right[current_level + 1];
 
             // merge left and right
-            node_cc_sorter_node_cc_less_t ccs_G_i_without_stars(node_component_node_cc_less_cmp(), SORTER_MEM);
+            const size_t num_labels_in = ccs_G_ip1_left_srtd_cc_node_less.size() + ccs_G_ip1_right.size() + node_contraction_G_i.size();
+            node_cc_sorter_node_cc_less_t ccs_G_i_without_stars(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
             ccs_G_ip1_left_srtd_cc_node_less.sort_reuse();
             std::cout << "Merge Component Maps (Left: " << ccs_G_ip1_left_srtd_cc_node_less.size() << ")"
                       << " with (Right: " << ccs_G_ip1_right.size() << ")" << std::endl;
@@ -654,6 +990,7 @@ private:
             assert(ccs_left[current_level + 1]->empty()); // checks whether the algorithm clears too early
 
             std::cout << "Merging: " << (foxxll::stats_data(*merging_stats) - merging_stats_begin).get_elapsed_time() << std::endl;
+            record_phase("merging", "", num_labels_in, 0, ccs_G_i.size(), 0, merging_stats_begin);
 
             // clear lower recursion level
             validate_depth(current_level + 1);
@@ -664,12 +1001,45 @@ private:
         } else {
             std::cout << "Node upper bound before sampling: " << nodes_upp_bnd << std::endl;
             std::cout << "Number of edges before sampling: " << in_edges_uqe.size() << std::endl;
-            int sampling_prob_power = policy.sample_prob_power(nodes_upp_bnd, in_edges_uqe.size(), current_level, main_memory_size / (sizeof(node_t) * StreamKruskal::MEMORY_OVERHEAD_FACTOR));
+            int sampling_prob_power = policy.sample_prob_power(nodes_upp_bnd, in_edges_uqe.size(), current_level, basecase_memory_size / (sizeof(node_t) * memory_overhead_factor));
+            const foxxll::stats_data sampling_stats_begin(*foxxll::stats::get_instance());
+
+            const unsigned num_sample_classes = sample_classes(nodes_upp_bnd, in_edges_uqe.size(), current_level);
+            if (num_sample_classes > 2) {
+                std::vector<std::unique_ptr<edge_sequence_t>> later_classes;
+                const auto [nodes_upp_bnd_G_i_sam, nodes_upp_bnd_classes_sam]
+                = split_edges(in_edges_uqe, current_level, sampling_prob_power, num_sample_classes, later_classes);
+                report_phase(phase_feedback_t::phase_t::sampling, current_level, nodes_upp_bnd_2, num_edges_G_i,
+                             nodes_upp_bnd_classes_sam[0], sub_edges_levels[current_level + 1]->size(), sampling_stats_begin, sampling_prob_power, "sample_classes");
+                const node_t nodes_upp_bnd_G_i = std::min(nodes_upp_bnd_2, nodes_upp_bnd_G_i_sam);
+
+                node_t num_ccs_G_i;
+                if (is_semi_externally_handleable(nodes_upp_bnd_G_i_sam)) {
+                    std::cout << "[OPTIMIZATION] After Sampling Estimates Fit Semi-Ext" << std::endl;
+                    num_ccs_G_i = semi_external(later_classes, current_level, get_component_map(left, current_level), nodes_upp_bnd_G_i,
+                                                "after_sampling_semi_external").second;
+                } else {
+                    num_ccs_G_i = process_sample_classes(current_level, left, nodes_upp_bnd_G_i, nodes_upp_bnd_classes_sam, later_classes).second;
+                    // the accumulated map is the one of G_i
+                    (left ? ccs_left[current_level] : ccs_right[current_level]).swap(ccs_left[current_level + 1]);
+                }
+
+                // clear lower recursion level
+                validate_depth(current_level + 1);
+                ccs_left [current_level + 1]->clear();
+                ccs_right[current_level + 1]->clear();
+
+                auto & ccs_G_i = get_component_map(left, current_level);
+                return std::make_pair(ccs_G_i.size(), num_ccs_G_i);
+            }
+
             const auto [nodes_upp_bnd_G_i_sam,
                         nodes_upp_bnd_G_ip1_left_sam,
                         nodes_upp_bnd_G_ip1_right_sam,
                         nodes_upp_bnd_G_ip1_common_sam]
 	            = sample_edges(in_edges_uqe, current_level, false, sampling_prob_power);
+            report_phase(phase_feedback_t::phase_t::sampling, current_level, nodes_upp_bnd_2, num_edges_G_i,
+                         nodes_upp_bnd_G_ip1_left_sam, sub_edges_levels[current_level + 1]->size(), sampling_stats_begin, sampling_prob_power);
 
             // if the sampling of the edges reveals that a semi-external run would have already been sufficient, do it
             if (is_semi_externally_handleable(nodes_upp_bnd_G_i_sam)) {
@@ -679,7 +1049,8 @@ private:
                 auto & edges_G_ip1_right  = *sub_edges_levels[current_level];
                 auto & ccs_G_i = get_component_map(left, current_level);
 
-                const auto [nodes_G_i, num_ccs_G_i] = semi_external(edges_G_ip1_left, edges_G_ip1_right, ccs_G_i);
+                const auto [nodes_G_i, num_ccs_G_i] = semi_external(edges_G_ip1_left, edges_G_ip1_right, ccs_G_i, std::min(nodes_upp_bnd_2, nodes_upp_bnd_G_i_sam), forest_or_null(left, current_level),
+                                                                    "after_sampling_semi_external");
                 reset_edges(current_level);
                 reset_edges(current_level + 1);
 
@@ -702,15 +1073,20 @@ private:
             node_t nodes_upp_bnd_G_ip1_right
             = std::min(std::min(std::min(std::min(nodes_upp_bnd_G_ip1_right_sam,
                      nodes_upp_bnd_G_ip1_right_sam - nodes_upp_bnd_G_ip1_common_sam + num_ccs_G_ip1_left),
-                     nodes_upp_bnd_G_i_sam - nodes_G_ip1_left + num_ccs_G_ip1_left),
-                       nodes_upp_bnd), nodes_upp_bnd - nodes_G_ip1_left + num_ccs_G_ip1_left);
+                     nodes_bound_after_left(nodes_upp_bnd_G_i_sam, nodes_G_ip1_left, num_ccs_G_ip1_left)),
+                       nodes_upp_bnd), nodes_bound_after_left(nodes_upp_bnd, nodes_G_ip1_left, num_ccs_G_ip1_left));
 
             //!! process right
-            node_cc_sorter_cc_node_less_t ccs_G_ip1_left_srtd_cc_node_less(node_component_cc_node_less_cmp(), SORTER_MEM);
+            MemoryReservation ccs_G_ip1_left_reservation;
+            node_cc_sorter_cc_node_less_t ccs_G_ip1_left_srtd_cc_node_less(node_component_cc_node_less_cmp(), reserve_sorter_mem(ccs_G_ip1_left_reservation, current_level + 1));
             const auto [nodes_G_ip1_right, num_ccs_G_ip1_right]
             = process_right(current_level, nodes_upp_bnd_G_ip1_right, ccs_G_ip1_left_srtd_cc_node_less);
             tlx::unused(nodes_G_ip1_right);
 
+            if (compute_forest) {
+                collect_forest(current_level, get_forest(left, current_level));
+            }
+
             // asserts and verification
             assert(sub_edges_levels[current_level]->size()     == 0);
             assert(sub_edges_levels[current_level + 1]->size() == 0);
@@ -738,22 +1114,32 @@ private:
         if (current_level > latest_max_level) {
             assert(current_level == latest_max_level + 1);
             sub_edges_levels.emplace_back(new edge_sequence_t());
-            ccs_left.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
-            ccs_right.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
+            ccs_left.emplace_back(new level_ccs_sorter_t(ccs_pool));
+            ccs_right.emplace_back(new level_ccs_sorter_t(ccs_pool));
             latest_max_level = current_level;
             std::cout << "Current Level is " << current_level << " and number of cc maps is " << ccs_left.size() << " where the last index is " << (ccs_left.size() - 1) << std::endl;
-            used_main_memory_size += 2 * SORTER_MEM;
         }
 
-        // base case
-        if (is_semi_externally_handleable(nodes_upp_bnd, in_edges)) {
+        // phases recorded meanwhile belong to this subproblem
+        const subproblem_t parent_subproblem = std::exchange(current_subproblem, subproblem_t{current_level, left});
+        const foxxll::stats_data subproblem_stats_begin(*foxxll::stats::get_instance());
+        const size_t num_edges_G_i = in_edges.size();
+        const bool basecase = is_semi_externally_handleable(nodes_upp_bnd, in_edges);
+
+        std::pair<node_t, node_t> node_cc_bounds;
+        if (basecase) {
             auto & ccs_G_i = get_component_map(left, current_level);
             assert(ccs_G_i.size() == 0);
-            return semi_external(in_edges, ccs_G_i);
+            node_cc_bounds = semi_external(in_edges, ccs_G_i, nodes_upp_bnd, forest_or_null(left, current_level));
         } else {
             assert((left ? *ccs_left[current_level] : *ccs_right[current_level]).size() == 0);
-            return fully_external(in_edges, nodes_upp_bnd, current_level, left);
+            node_cc_bounds = fully_external(in_edges, nodes_upp_bnd, current_level, left);
         }
+
+        record_phase("subproblem", (basecase ? "basecase" : "external"), nodes_upp_bnd, num_edges_G_i, node_cc_bounds.second, 0,
+                     subproblem_stats_begin, node_cc_bounds.first);
+        current_subproblem = parent_subproblem;
+        return node_cc_bounds;
     }
 
     template <typename InEdges>
@@ -763,6 +1149,21 @@ private:
         std::cout << "Sampling with probability 1/2^" << sample_prob_power << std::endl;
 
         PowerOfTwoCoin sample_coin(sample_prob_power);
+
+        // sketches of the nodes of both samples, their union covers G_i
+        std::optional<HyperLogLog> sketch_G_ip1_left, sketch_G_ip1_right;
+        if (sketch_error > 0) {
+            const unsigned precision = HyperLogLog::precision_for(sketch_error / SKETCH_CONFIDENCE);
+            sketch_G_ip1_left.emplace(gen, precision);
+            // same hash function, so that both can be merged
+            sketch_G_ip1_right.emplace(*sketch_G_ip1_left);
+        }
+        auto add_to_sketch = [](auto& sketch, const edge_t& last_edge, const edge_t& edge) {
+            if (!sketch) return;
+            if (last_edge.u != edge.u) (*sketch)(edge.u);
+            (*sketch)(edge.v);
+        };
+
         auto sample_stream = [&](auto& next_level, auto& this_level,
                                  node_t& count_G_i,
                                  node_t& count_G_ip1_left,
@@ -793,10 +1194,12 @@ private:
                 if (sample_coin(gen)) {
                     src_G_ip1_left = true;
                     next_level.push(in_edge_uqe);
+                    add_to_sketch(sketch_G_ip1_left, edge_G_ip1_left, in_edge_uqe);
                     increment_counter(count_G_ip1_left, edge_G_ip1_left, in_edge_uqe);
                 } else {
                     src_G_ip1_right = true;
                     this_level.push(in_edge_uqe);
+                    add_to_sketch(sketch_G_ip1_right, edge_G_ip1_right, in_edge_uqe);
                     increment_counter(count_G_ip1_right, edge_G_ip1_right, in_edge_uqe);
                 }
 
@@ -825,18 +1228,129 @@ private:
 
         std::cout << "Left sample simple node bound: " << cnt_G_ip1_left << std::endl;
 
+        if (sketch_G_ip1_left) {
+            tighten_sample_bounds(*sketch_G_ip1_left, *sketch_G_ip1_right, cnt_G_i, cnt_G_ip1_left, cnt_G_ip1_right, cnt_G_ip1_common);
+        }
+
         return std::make_tuple(cnt_G_i, cnt_G_ip1_left, cnt_G_ip1_right, cnt_G_ip1_common);
     }
 
+    /**
+     * Splits the edges in one scan into num_classes sample classes: each but
+     * the last class takes an edge that no earlier class took with probability
+     * 1/2^sample_prob_power, the last class takes the remaining edges. The
+     * first class becomes the left edges of the next level, the others are
+     * appended to later_classes.
+     *
+     * @return Node upper bound of G_i and the node upper bounds of the classes
+     */
+    template <typename InEdges>
+    std::pair<node_t, std::vector<node_t>> split_edges(InEdges& in_edges, size_t current_level, int sample_prob_power, unsigned num_classes,
+                                                       std::vector<std::unique_ptr<edge_sequence_t>>& later_classes) {
+        foxxll_timer sampling_timer("Sampling");
+        std::cout << "Splitting into " << num_classes << " sample classes with probability 1/2^" << sample_prob_power << std::endl;
+
+        PowerOfTwoCoin sample_coin(sample_prob_power);
+        assert(sub_edges_levels[current_level + 1]->size() == 0);
+        for (unsigned i = 1; i < num_classes; ++i) later_classes.emplace_back(new edge_sequence_t());
+
+        // sources are counted exactly and targets at least once
+        auto increment_counter = [](auto& count, edge_t& curr_edge, edge_t next_edge) {
+            count += (curr_edge.u != next_edge.u);
+            count += (curr_edge.v != next_edge.v);
+            curr_edge = next_edge;
+        };
+
+        node_t cnt_G_i = 0;
+        edge_t edge_G_i{MAX_NODE, MAX_NODE};
+        std::vector<node_t> cnt_classes(num_classes, 0);
+        std::vector<edge_t> edge_classes(num_classes, edge_t{MAX_NODE, MAX_NODE});
+        for (; !in_edges.empty(); ++in_edges) {
+            const auto in_edge_uqe = *in_edges;
+            increment_counter(cnt_G_i, edge_G_i, in_edge_uqe);
+
+            unsigned i = 0;
+            for (; i + 1 < num_classes && !sample_coin(gen); ++i);
+            increment_counter(cnt_classes[i], edge_classes[i], in_edge_uqe);
+            if (i == 0) {
+                sub_edges_levels[current_level + 1]->push(in_edge_uqe);
+            } else {
+                later_classes[i - 1]->push(in_edge_uqe);
+            }
+        }
+
+        sub_edges_levels[current_level + 1]->rewind();
+        std::cout << "Sample class sizes: " << sub_edges_levels[current_level + 1]->size();
+        for (auto & later_class : later_classes) {
+            later_class->rewind();
+            std::cout << " " << later_class->size();
+        }
+        std::cout << std::endl;
+
+        return std::make_pair(cnt_G_i, cnt_classes);
+    }
+
+    // number of sample classes the policy asks for, the forest is only computed for two
+    unsigned sample_classes(node_t nodes_upp_bnd, size_t num_edges, size_t current_level) const {
+        if (!policy.sample_classes) return 2;
+        const unsigned num_classes = std::clamp(policy.sample_classes(nodes_upp_bnd, num_edges, current_level, basecase_memory_size / (sizeof(node_t) * memory_overhead_factor)),
+                                                2u, MAX_SAMPLE_CLASSES);
+        if (num_classes > 2 && compute_forest) {
+            std::cout << "Sample classes yield no forest, splitting into two" << std::endl;
+            return 2;
+        }
+        return num_classes;
+    }
+
+    // combines the counting bounds of the sampling scan with the sketch estimates widened by the tolerated error
+    void tighten_sample_bounds(const HyperLogLog& sketch_left, const HyperLogLog& sketch_right,
+                               node_t& cnt_G_i, node_t& cnt_G_ip1_left, node_t& cnt_G_ip1_right, node_t& cnt_G_ip1_common) const {
+        HyperLogLog sketch_G_i(sketch_left);
+        sketch_G_i.merge(sketch_right);
+
+        auto upper = [&](const HyperLogLog& sketch) {
+            return static_cast<node_t>(std::ceil(sketch.estimate() * (1.0 + sketch_error)));
+        };
+        auto lower = [&](const HyperLogLog& sketch) {
+            return std::floor(sketch.estimate() * (1.0 - sketch_error));
+        };
+
+        cnt_G_i         = std::min(cnt_G_i, upper(sketch_G_i));
+        cnt_G_ip1_left  = std::min(cnt_G_ip1_left, upper(sketch_left));
+        cnt_G_ip1_right = std::min(cnt_G_ip1_right, upper(sketch_right));
+        // nodes in both samples, by inclusion-exclusion
+        const double common = lower(sketch_left) + lower(sketch_right) - static_cast<double>(upper(sketch_G_i));
+        if (common > 0) cnt_G_ip1_common = std::max(cnt_G_ip1_common, static_cast<node_t>(common));
+        cnt_G_ip1_common = std::min({cnt_G_ip1_common, cnt_G_ip1_left, cnt_G_ip1_right});
+
+        std::cout << "Sketched node bounds: " << cnt_G_i << " (left " << cnt_G_ip1_left
+                  << ", right " << cnt_G_ip1_right << ", common " << cnt_G_ip1_common << ")" << std::endl;
+    }
+
     [[nodiscard]] size_t get_current_depth() const {
         assert(ccs_left.size() == ccs_right.size());
         return ccs_left.size();
     }
 
+    // sorters kept per recursion level hold their memory as long as the manager exists
+    template <typename Sorter, typename Cmp>
+    Sorter* new_level_sorter(Cmp cmp) {
+        const size_t sorter_mem = MemoryBudget::instance().level_sorter_mem();
+        level_sorters_reservation.add(sorter_mem);
+        return new Sorter(cmp, sorter_mem);
+    }
+
+    // memory for a sorter that outlives the phase it is created in and holds data of level, held until reservation goes out of scope
+    static size_t reserve_sorter_mem(MemoryReservation& reservation, size_t level) {
+        const size_t sorter_mem = MemoryBudget::instance().level_data_sorter_mem(level);
+        reservation.add(sorter_mem);
+        return sorter_mem;
+    }
+
     void validate_depth(size_t depth) {
         if (depth >= get_current_depth()) {
-            ccs_left.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
-            ccs_right.emplace_back(new node_cc_sorter_node_cc_less_t(node_component_node_cc_less_cmp(), SORTER_MEM));
+            ccs_left.emplace_back(new level_ccs_sorter_t(ccs_pool));
+            ccs_right.emplace_back(new level_ccs_sorter_t(ccs_pool));
         }
     }
 
@@ -845,16 +1359,146 @@ private:
         sub_edges_levels[to_reset] = std::make_unique<edge_sequence_t>();
     }
 
+    // the relabelled right edges are still needed to lift the forest of the right subcall
+    void release_right_edges(size_t current_level) {
+        if (!compute_forest) {
+            reset_edges(current_level);
+        }
+    }
+
+    forest_sorter_t& get_forest(bool left, size_t current_level) {
+        auto & forests = (left ? forests_left : forests_right);
+        while (forests.size() <= current_level) {
+            forests.emplace_back(new_level_sorter<forest_sorter_t>(edge_less_cmp()));
+        }
+        return *forests[current_level];
+    }
+
+    forest_sorter_t* forest_or_null(bool left, size_t current_level) {
+        return (compute_forest ? &get_forest(left, current_level) : nullptr);
+    }
+
+    /**
+     * Moves the forests of both subcalls of G_i into forest_G_i: the left one
+     * as is, the right one lifted from the relabelled onto the right edges.
+     */
+    void collect_forest(size_t current_level, forest_sorter_t& forest_G_i) {
+        foxxll_timer lifting_timer("Lifting");
+        const foxxll::stats_data lifting_stats_begin(*foxxll::stats::get_instance());
+        MemoryPhase lifting_phase(MemoryBudget::phase_t::lifting);
+
+        auto & forest_G_ip1_left  = get_forest(true,  current_level + 1);
+        auto & forest_G_ip1_right = get_forest(false, current_level + 1);
+        auto & ccs_G_ip1_left     = *ccs_left[current_level + 1];
+        auto & edges_G_ip1_right  = *sub_edges_levels[current_level];
+
+        const size_t num_forest_edges_in = forest_G_ip1_left.size() + forest_G_ip1_right.size();
+        forest_G_ip1_left.sort();
+        StreamPusher(forest_G_ip1_left, forest_G_i);
+        forest_G_ip1_left.clear();
+
+        forest_G_ip1_right.sort();
+        ccs_G_ip1_left.rewind();
+        edges_G_ip1_right.rewind();
+        ForestLifter(ccs_G_ip1_left, edges_G_ip1_right, forest_G_ip1_right, forest_G_i);
+        forest_G_ip1_right.clear();
+        // leave the component map consumed, as process_right did
+        for (; !ccs_G_ip1_left.empty(); ++ccs_G_ip1_left);
+        reset_edges(current_level);
+        record_phase("lifting", "", 0, num_forest_edges_in, 0, forest_G_i.size(), lifting_stats_begin);
+    }
+
+    //! Lifts the forest of the contracted graph onto the edges of G_i
+    void lift_contracted_forest(node_cc_sorter_cc_node_less_t& node_contraction_G_i, edge_sequence_t& edges_G_i,
+                                forest_sorter_t& forest_contracted_G_i, forest_sorter_t& forest_G_i) {
+        foxxll_timer lifting_timer("Lifting");
+        const foxxll::stats_data lifting_stats_begin(*foxxll::stats::get_instance());
+        MemoryPhase lifting_phase(MemoryBudget::phase_t::lifting);
+        const size_t num_forest_edges_in = forest_contracted_G_i.size();
+
+        stxxl::sorter<node_component_t, node_component_node_cc_less_cmp> node_contraction_G_i_by_node(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
+        StreamPusher(node_contraction_G_i, node_contraction_G_i_by_node);
+        node_contraction_G_i.rewind();
+        node_contraction_G_i_by_node.sort_reuse();
+
+        forest_contracted_G_i.sort();
+        edges_G_i.rewind();
+        ForestLifter(node_contraction_G_i_by_node, edges_G_i, forest_contracted_G_i, forest_G_i);
+        forest_contracted_G_i.clear();
+        edges_G_i.clear();
+        record_phase("lifting", "contracted", 0, num_forest_edges_in, 0, forest_G_i.size(), lifting_stats_begin);
+    }
+
+    //! A base case whose workers' edge blocks fit the queue share of main memory
+    template <typename Kruskal>
+    Kruskal new_basecase() const {
+        if constexpr (std::is_same_v<Kruskal, ParallelKruskal>) {
+            return Kruskal(basecase_threads, 0, basecase_queue_size);
+        } else {
+            return Kruskal();
+        }
+    }
+
+    /**
+     * Number of nodes the base case is sized for up front: the node bound,
+     * but at most two nodes per edge and no more than the memory allows.
+     * The base case still grows if the estimate turns out too small.
+     */
+    [[nodiscard]] node_t basecase_nodes_estimate(node_t nodes_upp_bnd, size_t num_edges) const {
+        const size_t nodes_by_memory = basecase_memory_size / (sizeof(node_t) * memory_overhead_factor);
+        return static_cast<node_t>(std::min<size_t>({nodes_upp_bnd, 2 * num_edges, nodes_by_memory}));
+    }
+
+    // reports a measured phase to the policy, if it listens, and records it
+    void report_phase(phase_feedback_t::phase_t phase, size_t current_level, size_t nodes_in, size_t edges_in,
+                      size_t nodes_out, size_t edges_out, const foxxll::stats_data& stats_begin, int sample_prob_power = 0,
+                      const char* branch = "") const {
+        static constexpr const char* phase_names[] = {"contraction", "sampling", "relabelling"};
+        record_phase(phase_names[static_cast<size_t>(phase)], branch, nodes_in, edges_in, nodes_out, edges_out, stats_begin);
+        if (!policy.observe) return;
+        const foxxll::stats_data stats = foxxll::stats_data(*foxxll::stats::get_instance()) - stats_begin;
+        policy.observe(phase_feedback_t{phase, static_cast<unsigned>(current_level), nodes_in, edges_in, nodes_out, edges_out, sample_prob_power,
+                                        stats.get_elapsed_time(), stats.get_read_bytes() + stats.get_write_bytes()});
+    }
+
+    // records a phase of the current subproblem, if the telemetry is written
+    void record_phase(const char* phase, const char* branch, size_t nodes_in, size_t edges_in, size_t nodes_out, size_t edges_out,
+                      const foxxll::stats_data& stats_begin, size_t nodes_actual = 0) const {
+        auto & telemetry = PhaseTelemetry::instance();
+        if (!telemetry.enabled()) return;
+        const foxxll::stats_data stats = foxxll::stats_data(*foxxll::stats::get_instance()) - stats_begin;
+        telemetry.record(phase_record_t{static_cast<unsigned>(current_subproblem.level), current_subproblem.left, phase, branch,
+                                        nodes_in, edges_in, nodes_out, edges_out, nodes_actual, stats.get_elapsed_time(),
+                                        stats.get_io_wait_time(), stats.get_read_bytes(), stats.get_write_bytes()});
+    }
+
+    /**
+     * Node bound of G_i once the nodes of the left subproblem are contracted to
+     * their components. Bounds taken from sketches may fall below the nodes the
+     * left subproblem actually had; the bound then says nothing and MAX_NODE is
+     * returned instead of wrapping around.
+     */
+    static node_t nodes_bound_after_left(node_t nodes_upp_bnd, node_t nodes_left, node_t num_ccs_left) {
+        if (nodes_left > nodes_upp_bnd) return MAX_NODE;
+        return nodes_upp_bnd - nodes_left + num_ccs_left;
+    }
+
+    static void log_estimate_exceeded(node_t num_nodes, node_t nodes_estimate) {
+        if (num_nodes > nodes_estimate) {
+            std::cout << "Base case exceeded its node estimate (" << num_nodes << " > " << nodes_estimate << ")" << std::endl;
+        }
+    }
+
     inline auto & get_component_map(bool left, size_t current_level) {
         return (left ? *ccs_left[current_level] : *ccs_right[current_level]);
     }
 
     [[nodiscard]] bool is_semi_externally_handleable(node_t sub_problem_num_nodes) const {
-	    return sub_problem_num_nodes * sizeof(node_t) * StreamKruskal::MEMORY_OVERHEAD_FACTOR <= main_memory_size;
+	    return sub_problem_num_nodes * sizeof(node_t) * memory_overhead_factor <= basecase_memory_size;
     }
 
     template <typename InEdges>
     bool is_semi_externally_handleable(node_t sub_problem_num_nodes, InEdges& in_edges) const {
-	    return is_semi_externally_handleable(sub_problem_num_nodes) || 2 * sizeof(node_t) * in_edges.size() <= main_memory_size;
+	    return is_semi_externally_handleable(sub_problem_num_nodes) || 2 * sizeof(node_t) * in_edges.size() <= basecase_memory_size;
     }
 };
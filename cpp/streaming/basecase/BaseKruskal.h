@@ -6,25 +6,46 @@
 
 #pragma once
 
-#include "../../robin_hood.h"
 #include "../../defs.hpp"
 #include "../../util.hpp"
 #include "../hungdefs.hpp"
+#include "../containers/PresortedSorter.h"
+#include "../utils/ParallelRadixSort.h"
 
-#define im_node_map robin_hood::unordered_map
 #define simple_node_map std::vector
 
+/**
+ * Sequential union-find over compact node ids.
+ *
+ * Every node occupies one slot holding its original id and its parent; a
+ * root instead stores ROOT_FLAG together with its rank. Original ids are
+ * mapped to compact ids by an open-addressing table of compact ids (the key
+ * is looked up in the slot) or, if the ids are dense, by direct addressing.
+ * Per node this takes at most 2.5 words for the slots (grown by a quarter)
+ * plus 2 words for either id map, which is what MEMORY_OVERHEAD_FACTOR
+ * accounts for (see memory_bytes()). The id map is released while the slots
+ * are copied to their grown storage and rebuilt afterwards, so the transient
+ * peak of both copies (2 + 2.5 words) stays within the factor as well.
+ */
 class BaseKruskal {
 public:
-	static constexpr size_t MEMORY_OVERHEAD_FACTOR = 8;
+	static constexpr size_t MEMORY_OVERHEAD_FACTOR = 5;
+    // direct addressing is used while the id range is at most this factor times the number of nodes
+    static constexpr node_t DENSE_RANGE_FACTOR = 2;
+    // density is first checked once this many nodes are mapped and then whenever their number doubles
+    static constexpr node_t DENSE_CHECK_MIN_NODES = 1024;
+    // edges are mapped and merged in batches of this size, prefetching this many edges ahead
+    static constexpr size_t BATCH_EDGES = 1024;
+    static constexpr size_t PREFETCH_DISTANCE = 16;
+    // a kept spanning forest takes up to one edge per node on top
+    static constexpr size_t FOREST_OVERHEAD_FACTOR = 2;
 
-    BaseKruskal()
-    : _next_node(0),
-      _id_map(),
-      _reverse_map(),
-      _parent(),
-      _height()
-    { }
+    explicit BaseKruskal(node_t num_nodes_estimate = 0)
+    : _next_node(0)
+    {
+        reserve(num_nodes_estimate);
+        _batch.reserve(BATCH_EDGES);
+    }
 
     node_t get_num_nodes() const {
         return _next_node;
@@ -38,73 +59,403 @@ public:
         return _next_node - _num_unions;
     }
 
+    //! Use a direct-addressed id map for ids in [min_id, max_id]; ids outside are still handled
+    void set_id_range(node_t min_id, node_t max_id) {
+        assert(min_id <= max_id);
+        _min_id = std::min(_min_id, min_id);
+        _max_id = std::max(_max_id, max_id);
+        switch_to_dense(_min_id, _max_id);
+    }
+
+    bool uses_direct_addressing() const {
+        return _dense;
+    }
+
+    //! Sizes the slots and the id table for num_nodes nodes; more nodes are still accepted
+    void reserve(node_t num_nodes) {
+        if (num_nodes > _nodes.capacity()) {
+            const size_t id_map_size = release_id_map();
+            _nodes.reserve(num_nodes);
+            rebuild_id_map(id_map_size);
+        }
+        const size_t capacity = std::max<size_t>(MIN_TABLE_SIZE, num_nodes + num_nodes / 4 + 1);
+        if (!_dense && capacity > _id_table.size()) {
+            rebuild_table(capacity);
+        }
+    }
+
+    //! Records every edge that merges two components, see process_forest
+    void keep_forest() {
+        _keep_forest = true;
+    }
+
+    //! Pushes the recorded spanning forest (normalized edges with original ids) and releases it
+    template <typename EdgesOut>
+    void process_forest(EdgesOut& forest) {
+        flush_batch();
+        for (const edge_t& edge : _forest) {
+            forest.push(edge);
+        }
+        std::vector<edge_t>().swap(_forest);
+    }
+
+    //! Bytes needed on top of the per-node overhead, independent of the number of nodes
+    static constexpr size_t buffer_bytes(size_t /* num_threads */, size_t /* queue_bytes */ = 0) {
+        return 0;
+    }
+
+    //! Bytes currently allocated for slots and id maps
+    size_t memory_bytes() const {
+        return _nodes.capacity() * sizeof(node_slot)
+             + (_id_table.capacity() + _dense_map.capacity()) * sizeof(node_t);
+    }
+
 protected:
+    static constexpr node_t ROOT_FLAG = node_t{1} << (8 * sizeof(node_t) - 1);
+    static constexpr size_t MIN_TABLE_SIZE = 1024;
+
+    struct node_slot {
+        node_t id;   // original id
+        node_t link; // parent, or ROOT_FLAG | rank for a root
+    };
+
     node_t _num_unions = 0;
     node_t _next_node;
-    im_node_map<node_t, node_t> _id_map;
-    simple_node_map<node_t> _reverse_map;
-    simple_node_map<node_t> _parent;
-    simple_node_map<uint8_t> _height;
+    simple_node_map<node_slot> _nodes;
+
+    // open-addressing table of compact ids (MAX_NODE marks a free entry), kept below 80% load
+    simple_node_map<node_t> _id_table;
+
+    // direct-addressed id map for ids in [_dense_min, _dense_min + _dense_map.size())
+    bool _dense = false;
+    node_t _dense_min = 0;
+    simple_node_map<node_t> _dense_map;
+    node_t _min_id = MAX_NODE;
+    node_t _max_id = MIN_NODE;
+    node_t _next_density_check = DENSE_CHECK_MIN_NODES;
+
+    // edges not yet merged; see flush_batch
+    std::vector<edge_t> _batch;
+
+    // edges that merged two components, if kept
+    bool _keep_forest = false;
+    std::vector<edge_t> _forest;
+
+    // compact id of the most recent source; inputs sorted by source reuse it for the whole run
+    node_t _last_source = MAX_NODE;
+    node_t _last_source_id = MAX_NODE;
 
     template <typename ComponentsSorter>
     inline void process_output(ComponentsSorter& components) {
-        for (node_t i = 0; i < _reverse_map.size(); ++i) {
-            const node_t & u = _reverse_map[i];
-            const node_t & j = op_find(i);
-            const node_t & v = _reverse_map[j];
+        flush_batch();
+        if constexpr (accepts_presorted<ComponentsSorter>::value) {
+            if constexpr (std::is_same_v<typename ComponentsSorter::cmp_type, node_component_node_cc_less_cmp>) {
+                process_sorted_output(components);
+                return;
+            }
+        }
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            const node_t u = _nodes[i].id;
+            const node_t v = _nodes[op_find(i)].id;
             components.push(typename ComponentsSorter::value_type{u, v});
         }
     }
 
+    /**
+     * Emits (node, root) in node order without a sorter pass: the slots are
+     * turned into (id, root id) pairs in place and radix sorted by id in
+     * internal memory (ids are unique). The id maps are released first to
+     * make room for the sort buffer; the union-find is consumed.
+     */
+    template <typename ComponentsSorter>
+    void process_sorted_output(ComponentsSorter& components) {
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            op_find(i);
+        }
+        // every non-root now points to its root; roots keep their id
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            const node_t link = _nodes[i].link;
+            _nodes[i].link = _nodes[(link & ROOT_FLAG) ? i : link].id;
+        }
+
+        simple_node_map<node_t>().swap(_id_table);
+        simple_node_map<node_t>().swap(_dense_map);
+        {
+            simple_node_map<node_slot> buffer(_nodes.size());
+            parallel_radix_sort(_nodes.data(), buffer.data(), _nodes.size(), [](const node_slot& slot) { return slot.id; });
+        }
+
+        for (const node_slot& slot : _nodes) {
+            components.push_sorted(typename ComponentsSorter::value_type{slot.id, slot.link});
+        }
+        simple_node_map<node_slot>().swap(_nodes);
+    }
+
+    inline void batch_push(const edge_t& edge) {
+        _batch.push_back(edge);
+        if (TLX_UNLIKELY(_batch.size() == BATCH_EDGES)) {
+            flush_batch();
+        }
+    }
+
+    /**
+     * Merges the batched edges in two passes: first all ids are mapped, then
+     * all unions are performed. In both passes the memory touched by edges
+     * further ahead is prefetched (id map entries two distances ahead, the
+     * slots they point to one distance ahead), so that the cache misses in
+     * the id map and in the slots overlap instead of serializing.
+     */
+    void flush_batch() {
+        const size_t size = _batch.size();
+        edge_t* const batch = _batch.data();
+
+        for (size_t i = 0; i < size; ++i) {
+            // sources are only looked up at the start of a run
+            if (i + 2 * PREFETCH_DISTANCE < size) {
+                const edge_t& ahead = batch[i + 2 * PREFETCH_DISTANCE];
+                if (ahead.u != batch[i + 2 * PREFETCH_DISTANCE - 1].u) prefetch_id(ahead.u);
+                prefetch_id(ahead.v);
+            }
+            if (!_dense && i + PREFETCH_DISTANCE < size) {
+                const edge_t& ahead = batch[i + PREFETCH_DISTANCE];
+                if (ahead.u != batch[i + PREFETCH_DISTANCE - 1].u) prefetch_key(ahead.u);
+                prefetch_key(ahead.v);
+            }
+            batch[i].u = use_map_source(batch[i].u);
+            batch[i].v = use_map(batch[i].v);
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            if (i + PREFETCH_DISTANCE < size) {
+                __builtin_prefetch(&_nodes[batch[i + PREFETCH_DISTANCE].u], 1);
+                __builtin_prefetch(&_nodes[batch[i + PREFETCH_DISTANCE].v], 1);
+            }
+            const bool merged = op_union(batch[i].u, batch[i].v);
+            _num_unions += merged;
+            if (merged && _keep_forest) {
+                _forest.push_back(edge_t{_nodes[batch[i].u].id, _nodes[batch[i].v].id}.normalized());
+            }
+        }
+
+        _batch.clear();
+    }
+
+    // hints the id map entry of u; it may be stale if the map is rebuilt in between
+    inline void prefetch_id(node_t u) const {
+        if (_dense) {
+            const node_t index = u - _dense_min;
+            if (index < _dense_map.size()) {
+                __builtin_prefetch(&_dense_map[index]);
+            }
+        } else {
+            __builtin_prefetch(&_id_table[table_position(u)]);
+        }
+    }
+
+    // the table only holds compact ids, so a lookup also reads the slot of the first candidate
+    inline void prefetch_key(node_t u) const {
+        const node_t index = _id_table[table_position(u)];
+        if (index < _nodes.size()) {
+            __builtin_prefetch(&_nodes[index]);
+        }
+    }
+
+    inline node_t use_map_source(node_t u) {
+        if (u != _last_source) {
+            _last_source_id = use_map(u);
+            _last_source = u;
+        }
+        return _last_source_id;
+    }
+
     inline node_t use_map(node_t u) {
-        auto lookup = _id_map.find(u);
-        if (lookup == _id_map.end()) {
-            _id_map[u] = _next_node;
-            _reverse_map.push_back(u);
-            _parent.push_back(_next_node);
-            _height.push_back(0);
-            _next_node++;
-            return _next_node-1;
+        if (_dense) {
+            const node_t index = u - _dense_min;
+            if (TLX_LIKELY(index < _dense_map.size())) {
+                const node_t id = _dense_map[index];
+                if (id != MAX_NODE) {
+                    return id;
+                }
+                // adding the node may rebuild the map
+                const node_t new_id = add_node(u);
+                _dense_map[index] = new_id;
+                return new_id;
+            }
+            return use_map_out_of_range(u);
+        }
+
+        size_t pos = table_position(u);
+        for (node_t index; (index = _id_table[pos]) != MAX_NODE; ) {
+            if (_nodes[index].id == u) {
+                return index;
+            }
+            if (++pos == _id_table.size()) pos = 0;
+        }
+
+        _id_table[pos] = _next_node;
+        _min_id = std::min(_min_id, u);
+        _max_id = std::max(_max_id, u);
+        const node_t id = add_node(u);
+        if (TLX_UNLIKELY(5 * static_cast<size_t>(_next_node) > 4 * _id_table.size())) {
+            rebuild_table(2 * static_cast<size_t>(_next_node));
+        }
+        if (TLX_UNLIKELY(_next_node >= _next_density_check)) {
+            _next_density_check = 2 * _next_node;
+            if (is_dense_range(_min_id, _max_id)) {
+                switch_to_dense(_min_id, _max_id);
+            }
+        }
+        return id;
+    }
+
+    inline node_t add_node(node_t u) {
+        assert(_next_node < ROOT_FLAG);
+        if (TLX_UNLIKELY(_nodes.size() == _nodes.capacity())) {
+            // grow by a quarter to keep the slack within MEMORY_OVERHEAD_FACTOR;
+            // the id map is rebuilt including u, so it is not alive next to both copies of the slots
+            const size_t id_map_size = release_id_map();
+            _nodes.reserve(_nodes.size() + _nodes.size() / 4 + DENSE_CHECK_MIN_NODES);
+            _nodes.push_back(node_slot{u, ROOT_FLAG});
+            rebuild_id_map(id_map_size);
+            return _next_node++;
+        }
+        _nodes.push_back(node_slot{u, ROOT_FLAG});
+        return _next_node++;
+    }
+
+    // releases the id map in use and returns its size for rebuild_id_map
+    size_t release_id_map() {
+        const size_t size = (_dense ? _dense_map.size() : _id_table.size());
+        simple_node_map<node_t>().swap(_id_table);
+        simple_node_map<node_t>().swap(_dense_map);
+        return size;
+    }
+
+    // rebuilds the id map released by release_id_map from the slots
+    void rebuild_id_map(size_t size) {
+        if (!size) return;
+        if (_dense) {
+            switch_to_dense(_dense_min, _dense_min + static_cast<node_t>(size - 1));
         } else {
-            return lookup->second;
+            rebuild_table(size);
         }
     }
 
+    size_t table_position(node_t u) const {
+        // fibonacci hashing, mapped onto the table size by a multiply-shift
+        const uint64_t hash = static_cast<uint64_t>(u) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>((static_cast<unsigned __int128>(hash) * _id_table.size()) >> 64);
+    }
+
+    // the table is rebuilt from the slots; the old one is released first
+    void rebuild_table(size_t capacity) {
+        simple_node_map<node_t>().swap(_id_table);
+        _id_table.assign(capacity, MAX_NODE);
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            size_t pos = table_position(_nodes[i].id);
+            while (_id_table[pos] != MAX_NODE) {
+                if (++pos == _id_table.size()) pos = 0;
+            }
+            _id_table[pos] = i;
+        }
+    }
+
+    bool is_dense_range(node_t min_id, node_t max_id) const {
+        return max_id - min_id < DENSE_RANGE_FACTOR * std::max<node_t>(_next_node, DENSE_CHECK_MIN_NODES);
+    }
+
+    // both id maps are rebuilt from the slots, so the old one is released first
+    void switch_to_dense(node_t lo, node_t hi) {
+        _dense = true;
+        _dense_min = lo;
+        simple_node_map<node_t>().swap(_id_table);
+        simple_node_map<node_t>().swap(_dense_map);
+        _dense_map.assign(static_cast<size_t>(hi - lo) + 1, MAX_NODE);
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            _dense_map[_nodes[i].id - _dense_min] = i;
+        }
+    }
+
+    void switch_to_hashing() {
+        _dense = false;
+        simple_node_map<node_t>().swap(_dense_map);
+        rebuild_table(std::max<size_t>(MIN_TABLE_SIZE, 2 * static_cast<size_t>(_next_node)));
+    }
+
+    // grows the direct-addressed range with some slack, or falls back to hashing if ids become too sparse
+    node_t use_map_out_of_range(node_t u) {
+        _min_id = std::min(_min_id, u);
+        _max_id = std::max(_max_id, u);
+
+        // the range must stay below the density limit; without room for enough slack
+        // every further outlier would rebuild the map, so hash until the next density check
+        const node_t range = _max_id - _min_id;
+        const node_t limit = DENSE_RANGE_FACTOR * std::max<node_t>(_next_node, DENSE_CHECK_MIN_NODES);
+        const node_t wanted_slack = range / 2;
+        const node_t slack = (range < limit) ? std::min(wanted_slack, limit - 1 - range) : 0;
+        if (range >= limit || slack < wanted_slack / 4) {
+            switch_to_hashing();
+            return use_map(u);
+        }
+
+        node_t lo = _min_id;
+        node_t hi = _max_id;
+        if (u < _dense_min) {
+            lo -= std::min(slack, lo - MIN_NODE);
+        } else {
+            hi += std::min(slack, MAX_VALID_NODE - hi);
+        }
+        switch_to_dense(lo, hi);
+        return use_map(u);
+    }
+
     inline node_t op_find(node_t u) {
         // find root
         node_t root = u;
-        while (_parent[root] != root) {
-            root = _parent[root];
+        while (!(_nodes[root].link & ROOT_FLAG)) {
+            root = _nodes[root].link;
         }
 
         // apply path compression
-        node_t tmp;
-        while (_parent[u] != u) {
-            tmp = _parent[u];
-            _parent[u] = root;
+        while (u != root) {
+            const node_t tmp = _nodes[u].link;
+            _nodes[u].link = root;
             u = tmp;
         }
 
         return root;
     }
 
+    // single pass find that points every other node on the path to its grandparent
+    inline node_t op_find_halving(node_t u) {
+        for (;;) {
+            const node_t parent = _nodes[u].link;
+            if (parent & ROOT_FLAG) return u;
+            const node_t grandparent = _nodes[parent].link;
+            if (grandparent & ROOT_FLAG) return parent;
+            _nodes[u].link = grandparent;
+            u = grandparent;
+        }
+    }
+
     inline bool op_union(node_t u, node_t v) {
-        const node_t root_u = op_find(u);
-        const node_t root_v = op_find(v);
+        const node_t root_u = op_find_halving(u);
+        const node_t root_v = op_find_halving(v);
 
         // cycle detected
         if (root_u == root_v) return false;
 
-        // attach smaller to bigger tree
-        if (_height[root_u] < _height[root_v]) {
-            _parent[root_u] = root_v;
+        // attach smaller to bigger tree; ranks are stored next to ROOT_FLAG
+        node_t & link_u = _nodes[root_u].link;
+        node_t & link_v = _nodes[root_v].link;
+        if (link_u < link_v) {
+            link_u = root_v;
         } else {
-            _parent[root_v] = root_u;
-        }
-
-        // increment the height of the resulting tree if they are the same
-        if (_height[root_u] == _height[root_v]) {
-            ++_height[root_u];
+            // increment the height of the resulting tree if they are the same
+            if (link_u == link_v) {
+                ++link_u;
+            }
+            link_v = root_u;
         }
 
         return true;
@@ -0,0 +1,351 @@
+/*
+ * ParallelKruskal.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BaseKruskal.h"
+
+/**
+ * Multi-threaded variant of StreamKruskal / PipelinedKruskal.
+ *
+ * The calling thread maps node ids to compact ids and collects the mapped
+ * edges into blocks, which are handed to worker threads via a bounded queue.
+ * The workers merge components in a concurrent union-find: roots are linked
+ * by compare-and-swap (always the larger id below the smaller one, so no
+ * cycles can form) and finds apply path halving.
+ * Once all edges are pushed, the forest is flattened into BaseKruskal's
+ * slots so that process_output and process_to_map work unchanged.
+ */
+class ParallelKruskal final : public BaseKruskal {
+public:
+    // atomic parents on top of the sequential layout: one per node, at most two once rounded up
+    // to whole segments; the segment tables add a pointer per segment (see memory_bytes())
+    static constexpr size_t MEMORY_OVERHEAD_FACTOR = BaseKruskal::MEMORY_OVERHEAD_FACTOR + 2;
+    // the blocks queued, merged by the workers or being filled share the queue memory (QUEUE_MEM by default);
+    // blocks shrink down to MIN_BLOCK_EDGES to fit, then fewer threads are started
+    static constexpr size_t QUEUE_MEM = 32 * UIntScale::Mi;
+    static constexpr size_t BLOCK_EDGES = 64 * 1024;
+    static constexpr size_t MIN_BLOCK_EDGES = 64;
+    static constexpr size_t PENDING_BLOCKS_PER_THREAD = 4;
+
+    explicit ParallelKruskal(size_t num_threads = std::thread::hardware_concurrency(), node_t num_nodes_estimate = 0,
+                             size_t queue_bytes = QUEUE_MEM)
+    : _num_threads(fitting_threads(num_threads, queue_bytes)),
+      _block_edges(block_edges(_num_threads, queue_bytes)),
+      _queue_bytes(max_blocks(_num_threads) * _block_edges * sizeof(edge_t))
+    {
+        reserve(num_nodes_estimate);
+        _block.reserve(_block_edges);
+    }
+
+    //! Bytes of the edge blocks in flight; at most queue_bytes unless a single thread needs more
+    static constexpr size_t buffer_bytes(size_t num_threads, size_t queue_bytes = QUEUE_MEM) {
+        const size_t threads = fitting_threads(num_threads, queue_bytes);
+        return max_blocks(threads) * block_edges(threads, queue_bytes) * sizeof(edge_t);
+    }
+
+    size_t get_num_threads() const {
+        return _num_threads;
+    }
+
+    ParallelKruskal(const ParallelKruskal&) = delete;
+    ParallelKruskal& operator=(const ParallelKruskal&) = delete;
+
+    ~ParallelKruskal() {
+        stop_workers();
+    }
+
+    void push(edge_t edge) {
+        assert(!_finished);
+        const node_t u = use_map_source(edge.u);
+        const node_t v = use_map(edge.v);
+        if (u == v) return;
+        _block.push_back(edge_t{u, v});
+        if (TLX_UNLIKELY(_block.size() == _block_edges)) {
+            flush_block();
+        }
+    }
+
+    //! Also allocates the concurrent parents for num_nodes nodes; must be called before pushing
+    void reserve(node_t num_nodes) {
+        assert(_workers.empty());
+        BaseKruskal::reserve(num_nodes);
+        ensure_parents(num_nodes);
+    }
+
+    template <typename ComponentsSorter, typename... InEdges>
+    void process(ComponentsSorter& out_comps, InEdges&& ... in_streams) {
+        tlx::call_foreach(
+        [&](auto&& in_stream) { process_edge_stream(std::forward<decltype(in_stream)>(in_stream)); },
+        std::forward<InEdges>(in_streams) ...
+        );
+        finish();
+        process_output(out_comps);
+    }
+
+    //! Includes the concurrent parents, their segment tables and the edge blocks until finish() releases them
+    size_t memory_bytes() const {
+        size_t table_bytes = _segments.capacity() * sizeof(_segments[0]);
+        for (const auto& table : _tables) {
+            table_bytes += table.capacity() * sizeof(table[0]);
+        }
+        const size_t queue_bytes = (_finished ? 0 : _queue_bytes);
+        return BaseKruskal::memory_bytes() + (_segments.size() << _segment_bits) * sizeof(atomic_node_t) + table_bytes + queue_bytes;
+    }
+
+    node_t get_first_inserted_node() const {
+        return (!_nodes.empty() ? _nodes[0].id : MAX_NODE);
+    }
+
+    template <typename EdgesOut>
+    void process_forest(EdgesOut& forest) {
+        finish();
+        BaseKruskal::process_forest(forest);
+    }
+
+    template <typename OutputMap>
+    void process_to_map(OutputMap& output) {
+        finish();
+        for (node_t i = 0; i < _nodes.size(); ++i) {
+            const node_t u = _nodes[i].id;
+            const node_t root = _nodes[op_find(i)].id;
+            output[u] = root;
+        }
+    }
+
+    //! Waits for all pushed edges to be merged; the number of ccs is only valid afterwards
+    void finish() {
+        if (_finished) return;
+
+        ensure_parents(_next_node);
+        if (_workers.empty()) {
+            // few edges: not worth starting threads
+            _worker_forests.assign(1, {});
+            _worker_unions.assign(1, unite_block(_block, _worker_forests[0]));
+        } else {
+            flush_block();
+            stop_workers();
+        }
+        std::vector<edge_t>().swap(_block);
+
+        _num_unions = 0;
+        for (const node_t unions : _worker_unions) {
+            _num_unions += unions;
+        }
+        for (auto& forest : _worker_forests) {
+            for (const edge_t& edge : forest) {
+                _forest.push_back(edge_t{_nodes[edge.u].id, _nodes[edge.v].id}.normalized());
+            }
+            std::vector<edge_t>().swap(forest);
+        }
+
+        // flatten into the sequential slots; ranks are irrelevant from here on
+        for (node_t i = 0; i < _next_node; ++i) {
+            const node_t root = find(i);
+            _nodes[i].link = (root == i ? ROOT_FLAG : root);
+        }
+        _table.store(nullptr, std::memory_order_relaxed);
+        std::vector<std::vector<atomic_node_t*>>().swap(_tables);
+        std::vector<std::unique_ptr<atomic_node_t[]>>().swap(_segments);
+        _finished = true;
+    }
+
+private:
+    // parents live in lazily allocated segments so that workers never observe a reallocation;
+    // segments are sized from the first estimate, a single one if the estimate fits
+    static constexpr unsigned MIN_SEGMENT_BITS = 10;
+    static constexpr unsigned MAX_SEGMENT_BITS = 20;
+
+    using atomic_node_t = std::atomic<node_t>;
+
+    // queued blocks, one per worker, the full block waiting for the queue and the one being filled
+    static constexpr size_t max_blocks(size_t num_threads) {
+        return (PENDING_BLOCKS_PER_THREAD + 1) * num_threads + 2;
+    }
+
+    static constexpr size_t block_edges(size_t num_threads, size_t queue_bytes) {
+        return std::clamp<size_t>(queue_bytes / (max_blocks(num_threads) * sizeof(edge_t)), MIN_BLOCK_EDGES, BLOCK_EDGES);
+    }
+
+    // at least one thread, and no more than blocks of MIN_BLOCK_EDGES allow
+    static constexpr size_t fitting_threads(size_t num_threads, size_t queue_bytes) {
+        const size_t min_blocks = queue_bytes / (MIN_BLOCK_EDGES * sizeof(edge_t));
+        const size_t max_threads = (min_blocks > max_blocks(0) ? (min_blocks - max_blocks(0)) / (PENDING_BLOCKS_PER_THREAD + 1) : 0);
+        return std::clamp<size_t>(max_threads, 1, std::max<size_t>(num_threads, 1));
+    }
+
+    const size_t _num_threads;
+    const size_t _block_edges;
+    const size_t _queue_bytes;
+    unsigned _segment_bits = 0;
+    std::vector<std::unique_ptr<atomic_node_t[]>> _segments;
+    // a full table is replaced by a copy of twice the size; replaced ones stay valid for workers still reading them
+    std::vector<std::vector<atomic_node_t*>> _tables;
+    std::atomic<atomic_node_t* const*> _table{nullptr};
+
+    std::vector<edge_t> _block;
+    std::deque<std::vector<edge_t>> _queue;
+    std::mutex _queue_mutex;
+    std::condition_variable _queue_nonempty;
+    std::condition_variable _queue_nonfull;
+    bool _closed = false;
+
+    std::vector<std::thread> _workers;
+    std::vector<node_t> _worker_unions;
+    std::vector<std::vector<edge_t>> _worker_forests; // in compact ids
+    bool _finished = false;
+
+    template <typename EdgeStream>
+    void process_edge_stream(EdgeStream& edges) {
+        for (; !edges.empty(); ++edges) {
+            push(*edges);
+        }
+    }
+
+    atomic_node_t& parent(node_t u) const {
+        atomic_node_t* const* table = _table.load(std::memory_order_acquire);
+        return table[u >> _segment_bits][u & ((node_t{1} << _segment_bits) - 1)];
+    }
+
+    // called by the producer before publishing edges touching nodes below num_nodes
+    void ensure_parents(node_t num_nodes) {
+        if (!num_nodes) return;
+        if (!_segment_bits) {
+            _segment_bits = MIN_SEGMENT_BITS;
+            while (_segment_bits < MAX_SEGMENT_BITS && (size_t{1} << _segment_bits) < num_nodes) {
+                ++_segment_bits;
+            }
+        }
+        const size_t segment_size = size_t{1} << _segment_bits;
+        const size_t needed = (static_cast<size_t>(num_nodes) + segment_size - 1) >> _segment_bits;
+        if (needed <= _segments.size()) return;
+
+        const bool grow_table = (_tables.empty() || needed > _tables.back().size());
+        if (grow_table) {
+            std::vector<atomic_node_t*> table(std::max<size_t>(needed, _tables.empty() ? 0 : 2 * _tables.back().size()));
+            for (size_t i = 0; i < _segments.size(); ++i) {
+                table[i] = _segments[i].get();
+            }
+            _tables.push_back(std::move(table));
+        }
+        // entries beyond the published nodes are not read by any worker yet
+        auto& table = _tables.back();
+        while (_segments.size() < needed) {
+            auto segment = std::make_unique<atomic_node_t[]>(segment_size);
+            const node_t first = static_cast<node_t>(_segments.size() << _segment_bits);
+            for (size_t i = 0; i < segment_size; ++i) {
+                segment[i].store(first + static_cast<node_t>(i), std::memory_order_relaxed);
+            }
+            table[_segments.size()] = segment.get();
+            _segments.push_back(std::move(segment));
+        }
+        if (grow_table) {
+            _table.store(table.data(), std::memory_order_release);
+        }
+    }
+
+    void flush_block() {
+        if (_block.empty()) return;
+        ensure_parents(_next_node);
+        start_workers();
+
+        std::vector<edge_t> block;
+        block.reserve(_block_edges);
+        block.swap(_block);
+        {
+            std::unique_lock<std::mutex> lock(_queue_mutex);
+            _queue_nonfull.wait(lock, [&] { return _queue.size() < PENDING_BLOCKS_PER_THREAD * _num_threads; });
+            _queue.push_back(std::move(block));
+        }
+        _queue_nonempty.notify_one();
+    }
+
+    void start_workers() {
+        if (!_workers.empty()) return;
+        _worker_unions.assign(_num_threads, 0);
+        _worker_forests.assign(_num_threads, {});
+        for (size_t i = 0; i < _num_threads; ++i) {
+            _workers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    void stop_workers() {
+        {
+            std::lock_guard<std::mutex> lock(_queue_mutex);
+            _closed = true;
+        }
+        _queue_nonempty.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+        _workers.clear();
+    }
+
+    void work(size_t worker_id) {
+        node_t unions = 0;
+        for (;;) {
+            std::vector<edge_t> block;
+            {
+                std::unique_lock<std::mutex> lock(_queue_mutex);
+                _queue_nonempty.wait(lock, [&] { return _closed || !_queue.empty(); });
+                if (_queue.empty()) break;
+                block = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            _queue_nonfull.notify_one();
+            unions += unite_block(block, _worker_forests[worker_id]);
+        }
+        _worker_unions[worker_id] = unions;
+    }
+
+    node_t unite_block(const std::vector<edge_t>& block, std::vector<edge_t>& forest) const {
+        node_t unions = 0;
+        for (const auto& edge : block) {
+            const bool merged = unite(edge.u, edge.v);
+            unions += merged;
+            if (merged && _keep_forest) {
+                forest.push_back(edge);
+            }
+        }
+        return unions;
+    }
+
+    node_t find(node_t u) const {
+        for (;;) {
+            node_t p = parent(u).load(std::memory_order_acquire);
+            if (p == u) return u;
+            const node_t gp = parent(p).load(std::memory_order_acquire);
+            // path halving; losing the race only skips the shortcut
+            if (p != gp) {
+                parent(u).compare_exchange_weak(p, gp, std::memory_order_release, std::memory_order_relaxed);
+            }
+            u = gp;
+        }
+    }
+
+    bool unite(node_t u, node_t v) const {
+        for (;;) {
+            u = find(u);
+            v = find(v);
+            if (u == v) return false;
+            if (u < v) std::swap(u, v);
+            // link the larger root below the smaller one; retry if u stopped being a root
+            node_t expected = u;
+            if (parent(u).compare_exchange_strong(expected, v, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+};
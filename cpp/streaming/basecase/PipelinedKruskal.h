@@ -10,12 +10,15 @@
 
 class PipelinedKruskal final : public BaseKruskal {
 public:
+    using BaseKruskal::BaseKruskal;
+
+    //! Edges are merged in batches; counts and the id mapping include them after flush or process
     void push(edge_t edge) {
-        const node_t u = use_map(edge.u);
-        const node_t v = use_map(edge.v);
-        if (op_union(u, v)) {
-            ++_num_unions;
-        }
+        batch_push(edge);
+    }
+
+    void flush() {
+        flush_batch();
     }
 
     template <typename ComponentsSorter>
@@ -23,15 +26,17 @@ public:
         process_output(out_comps);
     }
 
-    node_t get_first_inserted_node() const {
-        return (!_reverse_map.empty() ? _reverse_map[0] : MAX_NODE);
+    node_t get_first_inserted_node() {
+        flush_batch();
+        return (!_nodes.empty() ? _nodes[0].id : MAX_NODE);
     }
 
 	template <typename OutputMap>
 	void process_to_map(OutputMap& output) {
-		for (node_t i = 0; i < _reverse_map.size(); ++i) {
-			const node_t u = _reverse_map[i];
-			const node_t root = _reverse_map[op_find(i)];
+		flush_batch();
+		for (node_t i = 0; i < _nodes.size(); ++i) {
+			const node_t u = _nodes[i].id;
+			const node_t root = _nodes[op_find(i)].id;
 			output[u] = root;
 		}
 	}
@@ -10,6 +10,8 @@
 
 class StreamKruskal final : public BaseKruskal {
 public:
+    using BaseKruskal::BaseKruskal;
+
     template <typename ComponentsSorter, typename... InEdges>
     void process(ComponentsSorter& out_comps, InEdges&& ... in_streams) {
         tlx::call_foreach(
@@ -23,12 +25,7 @@ private:
     template <typename EdgeStream>
     void process_edge_stream(EdgeStream& edges) {
         for (; !edges.empty(); ++edges) {
-            const auto edge = *edges;
-            const node_t u = use_map(edge.u);
-            const node_t v = use_map(edge.v);
-            if (op_union(u, v)) {
-                ++_num_unions;
-            }
+            batch_push(*edges);
         }
     }
 };
\ No newline at end of file
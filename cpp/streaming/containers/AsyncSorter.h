@@ -0,0 +1,304 @@
+/*
+ * AsyncSorter.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <tlx/define.hpp>
+
+//! Bounded FIFO of blocks between one producer and one consumer thread
+template <typename Block>
+class BoundedBlockQueue {
+public:
+    explicit BoundedBlockQueue(size_t capacity)
+    : _capacity(capacity)
+    { }
+
+    //! Waits for room; fails if the queue was cancelled
+    bool push(Block&& block) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_full.wait(lock, [&] { return _cancelled || _blocks.size() < _capacity; });
+        if (_cancelled) return false;
+        _blocks.push_back(std::move(block));
+        lock.unlock();
+        _not_empty.notify_one();
+        return true;
+    }
+
+    //! Waits for a block; fails once the queue is closed and drained or cancelled
+    bool pop(Block& block) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_empty.wait(lock, [&] { return _cancelled || _closed || !_blocks.empty(); });
+        if (_cancelled || _blocks.empty()) return false;
+        block = std::move(_blocks.front());
+        _blocks.pop_front();
+        lock.unlock();
+        _not_full.notify_one();
+        return true;
+    }
+
+    //! No more blocks follow
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _not_empty.notify_all();
+    }
+
+    //! Drops all blocks and makes both sides give up
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled = true;
+            _blocks.clear();
+        }
+        _not_empty.notify_all();
+        _not_full.notify_all();
+    }
+
+    //! Only valid while no thread uses the queue
+    void reset() {
+        _blocks.clear();
+        _closed = false;
+        _cancelled = false;
+    }
+
+private:
+    const size_t _capacity;
+    std::deque<Block> _blocks;
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+    bool _closed = false;
+    bool _cancelled = false;
+};
+
+/**
+ * Drop-in replacement for a sorter that overlaps its work with the threads
+ * producing and consuming its items.
+ *
+ * Pushed items are collected into blocks; once the first block is full, a
+ * writer thread takes over pushing them into the wrapped sorter, so run
+ * formation (sorting and writing runs) happens while the producer keeps
+ * scanning. After sorting, a reader thread merges the runs ahead of the
+ * consumer into a bounded queue of blocks. Small inputs are handled without
+ * threads.
+ * The wrapped sorter is only ever used by one thread at a time; the memory
+ * of the blocks in flight is taken from the memory given to the sorter.
+ */
+template <typename Sorter>
+class AsyncSorter {
+public:
+    using value_type = typename Sorter::value_type;
+    using cmp_type = typename Sorter::cmp_type;
+
+    static constexpr size_t BLOCK_ITEMS = 64 * 1024;
+    static constexpr size_t PENDING_BLOCKS = 4;
+    // the queued blocks, the one being filled and the one being drained
+    static constexpr size_t BUFFER_BYTES = (PENDING_BLOCKS + 2) * BLOCK_ITEMS * sizeof(value_type);
+
+    AsyncSorter(const cmp_type& cmp, size_t memory)
+    : _sorter(cmp, memory - std::min(memory / 2, BUFFER_BYTES)),
+      _queue(PENDING_BLOCKS)
+    {
+        _block.reserve(BLOCK_ITEMS);
+    }
+
+    AsyncSorter(const AsyncSorter&) = delete;
+    AsyncSorter& operator=(const AsyncSorter&) = delete;
+
+    ~AsyncSorter() {
+        stop();
+    }
+
+    void push(const value_type& item) {
+        assert(!_reading);
+        _block.push_back(item);
+        ++_size;
+        if (TLX_UNLIKELY(_block.size() == BLOCK_ITEMS)) {
+            hand_over();
+        }
+    }
+
+    void sort() {
+        finish_input();
+        _sorter.sort();
+        start_reading();
+    }
+
+    void sort_reuse() {
+        finish_input();
+        _sorter.sort_reuse();
+        start_reading();
+    }
+
+    void rewind() {
+        stop_reading();
+        _sorter.rewind();
+        start_reading();
+    }
+
+    void clear() {
+        stop();
+        _sorter.clear();
+        _size = 0;
+    }
+
+    void finish_clear() {
+        stop();
+        _sorter.finish_clear();
+        _size = 0;
+    }
+
+    //! Items pushed so far, or items not yet consumed once sorted
+    size_t size() const {
+        return _size - (_reading ? _consumed : 0);
+    }
+
+    bool empty() const {
+        return _pos == _current.size();
+    }
+
+    const value_type& operator*() const {
+        assert(!empty());
+        return _current[_pos];
+    }
+
+    AsyncSorter& operator++() {
+        assert(!empty());
+        ++_consumed;
+        if (++_pos == _current.size()) {
+            fetch();
+        }
+        return *this;
+    }
+
+private:
+    using block_type = std::vector<value_type>;
+
+    Sorter _sorter;
+    BoundedBlockQueue<block_type> _queue;
+    std::thread _writer;
+    std::thread _reader;
+
+    // input side
+    block_type _block;
+    size_t _size = 0;
+
+    // output side
+    bool _reading = false;
+    block_type _current;
+    size_t _pos = 0;
+    size_t _consumed = 0;
+
+    void hand_over() {
+        if (!_writer.joinable()) {
+            _writer = std::thread([this] {
+                block_type block;
+                while (_queue.pop(block)) {
+                    for (const auto& item : block) {
+                        _sorter.push(item);
+                    }
+                }
+            });
+        }
+        block_type block;
+        block.reserve(BLOCK_ITEMS);
+        block.swap(_block);
+        _queue.push(std::move(block));
+    }
+
+    void finish_input() {
+        assert(!_reading);
+        if (_writer.joinable()) {
+            if (!_block.empty()) {
+                _queue.push(std::move(_block));
+            }
+            _queue.close();
+            _writer.join();
+            _queue.reset();
+        } else {
+            for (const auto& item : _block) {
+                _sorter.push(item);
+            }
+        }
+        block_type().swap(_block);
+    }
+
+    void start_reading() {
+        _reading = true;
+        _consumed = 0;
+        if (_size <= BLOCK_ITEMS) {
+            // few items: read them right away
+            _current.clear();
+            for (; !_sorter.empty(); ++_sorter) {
+                _current.push_back(*_sorter);
+            }
+            _pos = 0;
+            return;
+        }
+
+        _reader = std::thread([this] {
+            block_type block;
+            block.reserve(BLOCK_ITEMS);
+            for (; !_sorter.empty(); ++_sorter) {
+                block.push_back(*_sorter);
+                if (block.size() == BLOCK_ITEMS) {
+                    if (!_queue.push(std::move(block))) return;
+                    block = block_type();
+                    block.reserve(BLOCK_ITEMS);
+                }
+            }
+            if (!block.empty()) {
+                _queue.push(std::move(block));
+            }
+            _queue.close();
+        });
+        fetch();
+    }
+
+    // replaces the drained block by the next one from the reader
+    void fetch() {
+        _pos = 0;
+        _current.clear();
+        if (_reader.joinable() && !_queue.pop(_current)) {
+            _reader.join();
+            _queue.reset();
+        }
+    }
+
+    void stop_reading() {
+        if (_reader.joinable()) {
+            _queue.cancel();
+            _reader.join();
+            _queue.reset();
+        }
+        block_type().swap(_current);
+        _pos = 0;
+        _consumed = 0;
+        _reading = false;
+    }
+
+    // drops items in flight in either direction
+    void stop() {
+        if (_writer.joinable()) {
+            _queue.cancel();
+            _writer.join();
+            _queue.reset();
+        }
+        _block.clear();
+        stop_reading();
+    }
+};
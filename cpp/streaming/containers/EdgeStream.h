@@ -10,22 +10,39 @@
 
 #include "../../defs.hpp"
 #include "../hungdefs.hpp"
+#include "EdgeStreamPool.h"
 #include <stxxl/sequence>
 #include <memory>
 
-class EdgeStream {
+/**
+ * External memory stream of edges sorted by (u, v).
+ *
+ * In the plain encoding every target is stored as a node_t and every new
+ * source as an additional node_t with kOutNodeSwitch set.
+ * In the compressed encoding sources are delta coded, targets are gap coded
+ * within a run of a source and all values are written as variable-length
+ * bytes (7 payload bits per byte) which are packed into node_t words.
+ *
+ * Blocks are taken from the shared EdgeStreamPool; a prefetch depth is only
+ * leased while the stream is being read.
+ */
+template <bool Compressed>
+class BasicEdgeStream {
 public:
     using value_type = edge_t;
 
 protected:
     static_assert(std::is_unsigned_v<node_t>, "left bit shift are ub for signed type");
     static constexpr node_t kOutNodeSwitch = node_t{1} << (8*sizeof(node_t) - 1);
+    static constexpr unsigned kBytesPerWord = sizeof(node_t);
+    static constexpr size_t kPrefetchBlocks = 16;
 
     using em_buffer_t = stxxl::sequence<node_t>;
     using em_reader_t = typename em_buffer_t::stream;
 
     std::unique_ptr<em_buffer_t> _em_buffer;
     std::unique_ptr<em_reader_t> _em_reader;
+    EdgeStreamPoolLease _prefetch_lease;
 
     enum Mode {WRITING, READING};
     Mode _mode;
@@ -45,24 +62,29 @@ protected:
     value_type _current;
     bool _empty;
 
+    // COMPRESSED: bytes packed into / unpacked from the current word
+    node_t _word;
+    unsigned _word_bytes;
+    size_t _remaining_edges;
+
 public:
-    EdgeStream(bool multi_edges = true, bool loops = true)
+    BasicEdgeStream(bool multi_edges = true, bool loops = true)
     : _allow_multi_edges(multi_edges)
     , _allow_loops(loops)
     , _current(MAX_EDGE)
     {clear();}
 
-    EdgeStream(const EdgeStream &) = delete; // ; , bool multi_edges = false, bool loops = false) = delete;
+    BasicEdgeStream(const BasicEdgeStream &) = delete; // ; , bool multi_edges = false, bool loops = false) = delete;
 
-    ~EdgeStream() {
+    ~BasicEdgeStream() {
         // in this order ;)
         _em_reader.reset(nullptr);
         _em_buffer.reset(nullptr);
     }
 
-    EdgeStream(EdgeStream&&) = default;
+    BasicEdgeStream(BasicEdgeStream&&) = default;
 
-    EdgeStream& operator=(EdgeStream&&) = default;
+    BasicEdgeStream& operator=(BasicEdgeStream&&) = default;
 
     // Write interface
     void push(const edge_t& edge) {
@@ -89,12 +111,23 @@ public:
         // ensure order
         assert(!_number_of_edges || _current <= edge);
 
-        if (_current_out_node != edge.u) {
-            _em_buffer->push_back(edge.u | kOutNodeSwitch);
-            _current_out_node = edge.u;
+        if constexpr (Compressed) {
+            // the lowest bit tags whether a new source starts
+            if (!_number_of_edges || _current_out_node != edge.u) {
+                put_varint(((edge.u - _current_out_node) << 1) | 1);
+                put_varint(zigzag_encode(edge.v, edge.u));
+                _current_out_node = edge.u;
+            } else {
+                put_varint((edge.v - _current.v) << 1);
+            }
+        } else {
+            if (_current_out_node != edge.u) {
+                _em_buffer->push_back(edge.u | kOutNodeSwitch);
+                _current_out_node = edge.u;
+            }
+
+            _em_buffer->push_back(edge.v);
         }
-
-        _em_buffer->push_back(edge.v);
         _number_of_edges++;
 
         _current = edge;
@@ -105,13 +138,29 @@ public:
 
     //! switches to read mode and resets the stream
     void rewind() {
+        if constexpr (Compressed) {
+            // flush the partially filled word once; trailing zero bytes are never decoded
+            if (_mode == WRITING && _word_bytes) {
+                _em_buffer->push_back(_word);
+            }
+            _word = 0;
+            _word_bytes = 0;
+            _remaining_edges = _number_of_edges;
+        }
+
         _mode = READING;
+        _em_reader.reset(nullptr);
+        _prefetch_lease.reset();
+        _prefetch_lease = EdgeStreamPoolLease(kPrefetchBlocks);
+        _em_buffer->set_prefetch_aggr(_prefetch_lease.blocks());
         _em_reader.reset(new em_reader_t(*_em_buffer));
         _current = {0, 0};
         _empty = _em_reader->empty();
 
         if (!empty())
             ++(*this);
+        else
+            _prefetch_lease.reset();
     }
 
     // returns back to writing mode on an empty stream
@@ -121,11 +170,16 @@ public:
         _number_of_edges = 0;
         _number_of_multiedges = 0;
         _number_of_selfloops = 0;
+        _word = 0;
+        _word_bytes = 0;
+        _remaining_edges = 0;
         _em_reader.reset(nullptr);
-        _em_buffer.reset(new em_buffer_t(16, 16));
+        _prefetch_lease.reset();
+        // no prefetch hints while writing
+        _em_buffer.reset(new em_buffer_t(EdgeStreamPool::instance().pool(), 0));
     }
 
-    void swap(EdgeStream& other) {
+    void swap(BasicEdgeStream& other) {
         std::swap(*this, other);
     }
 
@@ -142,6 +196,11 @@ public:
         return _number_of_multiedges;
     }
 
+    //! Number of node_t words written to external memory
+    size_t encoded_words() const {
+        return _em_buffer->size();
+    }
+
 // Consume interface
     //! return true when in write mode or if edge list is empty
     bool empty() const {
@@ -159,29 +218,168 @@ public:
     }
 
 
-    EdgeStream& operator++() {
+    BasicEdgeStream& operator++() {
         assert(READING == _mode);
         assert(!_empty);
 
-        em_reader_t& reader = *_em_reader;
-
-        // handle end of stream
-        _empty = reader.empty();
-        if (_empty)
-            return *this;
-
-        if (*reader >= kOutNodeSwitch) {
-            _current.u = *reader & ~kOutNodeSwitch;
+        if constexpr (Compressed) {
+            // handle end of stream
+            _empty = !_remaining_edges;
+            if (_empty) {
+                _prefetch_lease.reset();
+                return *this;
+            }
+            --_remaining_edges;
+
+            const node_t head = get_varint();
+            if (head & 1) {
+                _current.u += head >> 1;
+                _current.v = zigzag_decode(get_varint(), _current.u);
+            } else {
+                _current.v += head >> 1;
+            }
+        } else {
+            em_reader_t& reader = *_em_reader;
+
+            // handle end of stream
+            _empty = reader.empty();
+            if (_empty) {
+                _prefetch_lease.reset();
+                return *this;
+            }
+
+            if (*reader >= kOutNodeSwitch) {
+                _current.u = *reader & ~kOutNodeSwitch;
+                ++reader;
+            }
+
+            assert(!reader.empty());
+            _current.v = *reader;
+            assert(_current.v < kOutNodeSwitch);
             ++reader;
         }
 
-        assert(!reader.empty());
-        _current.v = *reader;
-        assert(_current.v < kOutNodeSwitch);
-        ++reader;
-
         die_unless_valid_edge(_current);
 
         return *this;
     }
+
+    /**
+     * Pushes all edges whose source is smaller than node into out and stops
+     * at the first edge with a larger source. Only source switches are
+     * compared against node; the targets of a source are copied in a tight
+     * loop. Forwarded edges are validated like in operator++. Returns the
+     * number of distinct sources forwarded.
+     */
+    template <typename Out>
+    size_t forward_sources_below(node_t node, Out& out) {
+        assert(READING == _mode);
+        size_t num_sources = 0;
+        while (!_empty && _current.u < node) {
+            ++num_sources;
+            out.push(_current);
+
+            if constexpr (Compressed) {
+                for (;;) {
+                    if (!_remaining_edges) {
+                        _empty = true;
+                        _prefetch_lease.reset();
+                        return num_sources;
+                    }
+                    --_remaining_edges;
+
+                    const node_t head = get_varint();
+                    if (head & 1) {
+                        _current.u += head >> 1;
+                        _current.v = zigzag_decode(get_varint(), _current.u);
+                        die_unless_valid_edge(_current);
+                        break;
+                    }
+                    _current.v += head >> 1;
+                    die_unless_valid_edge(_current);
+                    out.push(_current);
+                }
+            } else {
+                em_reader_t& reader = *_em_reader;
+                for (; !reader.empty() && *reader < kOutNodeSwitch; ++reader) {
+                    _current.v = *reader;
+                    die_unless_valid_edge(_current);
+                    out.push(_current);
+                }
+                ++(*this);
+            }
+        }
+        return num_sources;
+    }
+
+protected:
+    static node_t zigzag_encode(node_t v, node_t u) {
+        return (v >= u) ? (v - u) << 1 : ((u - v) << 1) - 1;
+    }
+
+    static node_t zigzag_decode(node_t z, node_t u) {
+        return (z & 1) ? u - ((z + 1) >> 1) : u + (z >> 1);
+    }
+
+    void put_byte(uint8_t byte) {
+        _word |= static_cast<node_t>(byte) << (8 * _word_bytes);
+        if (++_word_bytes == kBytesPerWord) {
+            _em_buffer->push_back(_word);
+            _word = 0;
+            _word_bytes = 0;
+        }
+    }
+
+    void put_varint(node_t x) {
+        while (x >= 0x80) {
+            put_byte(static_cast<uint8_t>(x) | 0x80);
+            x >>= 7;
+        }
+        put_byte(static_cast<uint8_t>(x));
+    }
+
+    uint8_t get_byte() {
+        if (!_word_bytes) {
+            assert(!_em_reader->empty());
+            _word = **_em_reader;
+            ++(*_em_reader);
+            _word_bytes = kBytesPerWord;
+        }
+        const auto byte = static_cast<uint8_t>(_word);
+        _word >>= 8;
+        --_word_bytes;
+        return byte;
+    }
+
+    node_t get_varint() {
+        node_t x = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            const uint8_t byte = get_byte();
+            x |= static_cast<node_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return x;
+        }
+    }
 };
+
+using EdgeStream = BasicEdgeStream<false>;
+using CompressedEdgeStream = BasicEdgeStream<true>;
+
+//! Fallback of BasicEdgeStream::forward_sources_below for other edge streams sorted by source
+template <typename InEdges, typename Out>
+size_t forward_sources_below(InEdges& edges, node_t node, Out& out) {
+    size_t num_sources = 0;
+    node_t last_source = MAX_NODE;
+    for (; !edges.empty() && (*edges).u < node; ++edges) {
+        const edge_t edge = *edges;
+        num_sources += (!num_sources || edge.u != last_source);
+        last_source = edge.u;
+        out.push(edge);
+    }
+    return num_sources;
+}
+
+template <bool Compressed, typename Out>
+size_t forward_sources_below(BasicEdgeStream<Compressed>& edges, node_t node, Out& out) {
+    return edges.forward_sources_below(node, out);
+}
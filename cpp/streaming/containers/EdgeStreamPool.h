@@ -0,0 +1,135 @@
+/*
+ * EdgeStreamPool.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <utility>
+
+#include <foxxll/mng/read_write_pool.hpp>
+#include <stxxl/sequence>
+#include "../../defs.hpp"
+
+/**
+ * Process-wide block pool shared by all EdgeStreams.
+ *
+ * Write-back and prefetch blocks of every stream come from a single
+ * read_write_pool sized by a global budget, so the memory held by buffers
+ * does not grow with the number of streams (e.g. one per recursion level).
+ * Reading streams lease a prefetch depth on rewind and return it once they
+ * are exhausted or cleared; idle streams hold no prefetch blocks.
+ * Leases may be taken and returned from any thread; set_budget must only
+ * be called while no stream is alive.
+ */
+class EdgeStreamPool {
+public:
+    using sequence_type = stxxl::sequence<node_t>;
+    using block_type = typename sequence_type::block_type;
+    using pool_type = foxxll::read_write_pool<block_type>;
+
+    static constexpr size_t kBlockBytes = sequence_type::block_size;
+    // the sequence requires at least 3 write blocks; keep one block for prefetching
+    static constexpr size_t kMinWriteBlocks = 3;
+    static constexpr size_t kMinPrefetchBlocks = 1;
+    static constexpr size_t kMinBudget = (kMinWriteBlocks + kMinPrefetchBlocks) * kBlockBytes;
+
+    static EdgeStreamPool& instance() {
+        static EdgeStreamPool pool(EDGE_STREAM_POOL_MEM);
+        return pool;
+    }
+
+    //! Resizes the pool; blocks currently in use are returned lazily
+    void set_budget(size_t bytes) {
+        const size_t blocks = std::max(bytes / kBlockBytes, kMinWriteBlocks + kMinPrefetchBlocks);
+        _write_blocks = std::max(blocks / 2, kMinWriteBlocks);
+        _prefetch_blocks = std::max(blocks - _write_blocks, kMinPrefetchBlocks);
+        _pool.resize_write(_write_blocks);
+        _pool.resize_prefetch(_prefetch_blocks);
+    }
+
+    size_t budget() const {
+        return (_write_blocks + _prefetch_blocks) * kBlockBytes;
+    }
+
+    pool_type& pool() {
+        return _pool;
+    }
+
+    //! Grants up to wanted prefetch blocks, each new lease takes at most half (rounded up) of what is left; 0 once the pool is exhausted
+    size_t lease(size_t wanted) {
+        size_t leased = _leased.load(std::memory_order_relaxed);
+        size_t granted;
+        do {
+            const size_t available = _prefetch_blocks - std::min(leased, _prefetch_blocks);
+            granted = std::min(wanted, (available + 1) / 2);
+        } while (!_leased.compare_exchange_weak(leased, leased + granted, std::memory_order_relaxed));
+        return granted;
+    }
+
+    void release(size_t granted) {
+        [[maybe_unused]] const size_t leased = _leased.fetch_sub(granted, std::memory_order_relaxed);
+        assert(granted <= leased);
+    }
+
+    size_t leased() const {
+        return _leased.load(std::memory_order_relaxed);
+    }
+
+private:
+    pool_type _pool;
+    size_t _write_blocks = 0;
+    size_t _prefetch_blocks = 0;
+    std::atomic<size_t> _leased{0};
+
+    explicit EdgeStreamPool(size_t bytes)
+    : _pool(kMinPrefetchBlocks, kMinWriteBlocks)
+    {set_budget(bytes);}
+};
+
+//! Prefetch depth leased from the EdgeStreamPool; returned on reset or destruction
+class EdgeStreamPoolLease {
+public:
+    EdgeStreamPoolLease() = default;
+
+    explicit EdgeStreamPoolLease(size_t wanted)
+    : _blocks(EdgeStreamPool::instance().lease(wanted))
+    {}
+
+    EdgeStreamPoolLease(const EdgeStreamPoolLease&) = delete;
+    EdgeStreamPoolLease& operator=(const EdgeStreamPoolLease&) = delete;
+
+    EdgeStreamPoolLease(EdgeStreamPoolLease&& other) noexcept
+    : _blocks(std::exchange(other._blocks, 0))
+    {}
+
+    EdgeStreamPoolLease& operator=(EdgeStreamPoolLease&& other) noexcept {
+        if (this != &other) {
+            reset();
+            _blocks = std::exchange(other._blocks, 0);
+        }
+        return *this;
+    }
+
+    ~EdgeStreamPoolLease() {
+        reset();
+    }
+
+    void reset() {
+        if (_blocks) {
+            EdgeStreamPool::instance().release(_blocks);
+            _blocks = 0;
+        }
+    }
+
+    size_t blocks() const {
+        return _blocks;
+    }
+
+private:
+    size_t _blocks = 0;
+};
@@ -0,0 +1,161 @@
+/*
+ * PooledSorter.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../utils/MemoryBudget.h"
+
+/**
+ * Recycles sorters (and with them their run buffers) between users that are
+ * rarely filled at the same time, e.g. the component maps of the recursion
+ * levels. At most max_idle cleared sorters are kept; the memory of every
+ * sorter is reserved in the MemoryBudget as long as it exists.
+ */
+template <typename Sorter>
+class SorterPool {
+public:
+    using sorter_type = Sorter;
+    using cmp_type = typename Sorter::cmp_type;
+
+    SorterPool(const cmp_type& cmp, size_t sorter_mem, size_t max_idle)
+    : _cmp(cmp), _sorter_mem(sorter_mem), _max_idle(max_idle)
+    { }
+
+    SorterPool(const SorterPool&) = delete;
+    SorterPool& operator=(const SorterPool&) = delete;
+
+    std::unique_ptr<Sorter> acquire() {
+        if (!_idle.empty()) {
+            auto sorter = std::move(_idle.back());
+            _idle.pop_back();
+            return sorter;
+        }
+        _reservation.add(_sorter_mem);
+        ++_num_sorters;
+        return std::make_unique<Sorter>(_cmp, _sorter_mem);
+    }
+
+    void recycle(std::unique_ptr<Sorter> sorter) {
+        assert(sorter);
+        if (_idle.size() < _max_idle) {
+            sorter->clear();
+            _idle.push_back(std::move(sorter));
+        } else {
+            sorter.reset(nullptr);
+            _reservation.remove(_sorter_mem);
+            --_num_sorters;
+        }
+    }
+
+    //! Sorters currently in use or idle
+    size_t num_sorters() const {
+        return _num_sorters;
+    }
+
+    size_t num_idle() const {
+        return _idle.size();
+    }
+
+private:
+    const cmp_type _cmp;
+    const size_t _sorter_mem;
+    const size_t _max_idle;
+    size_t _num_sorters = 0;
+    std::vector<std::unique_ptr<Sorter>> _idle;
+    MemoryReservation _reservation;
+};
+
+/**
+ * Sorter interface over a sorter that is taken from a SorterPool on the
+ * first push and handed back on clear. While it holds no sorter it behaves
+ * like an empty sorter in any state.
+ */
+template <typename Sorter>
+class PooledSorter {
+public:
+    using value_type = typename Sorter::value_type;
+    using cmp_type = typename Sorter::cmp_type;
+    using pool_type = SorterPool<Sorter>;
+
+    explicit PooledSorter(pool_type& pool)
+    : _pool(pool)
+    { }
+
+    PooledSorter(const PooledSorter&) = delete;
+    PooledSorter& operator=(const PooledSorter&) = delete;
+
+    ~PooledSorter() {
+        clear();
+    }
+
+    void push(const value_type& item) {
+        acquire().push(item);
+    }
+
+    //! Only available if the pooled sorter accepts presorted items
+    template <typename S = Sorter>
+    auto push_sorted(const value_type& item) -> decltype(std::declval<S&>().push_sorted(item)) {
+        return acquire().push_sorted(item);
+    }
+
+    void sort() {
+        if (_sorter) _sorter->sort();
+    }
+
+    void sort_reuse() {
+        if (_sorter) _sorter->sort_reuse();
+    }
+
+    void rewind() {
+        if (_sorter) _sorter->rewind();
+    }
+
+    //! Hands the sorter back to the pool
+    void clear() {
+        if (_sorter) _pool.recycle(std::move(_sorter));
+    }
+
+    void finish_clear() {
+        clear();
+    }
+
+    size_t size() const {
+        return (_sorter ? _sorter->size() : 0);
+    }
+
+    bool empty() const {
+        return !_sorter || _sorter->empty();
+    }
+
+    bool holds_sorter() const {
+        return static_cast<bool>(_sorter);
+    }
+
+    const value_type& operator*() const {
+        assert(!empty());
+        return **_sorter;
+    }
+
+    PooledSorter& operator++() {
+        assert(!empty());
+        ++(*_sorter);
+        return *this;
+    }
+
+private:
+    pool_type& _pool;
+    std::unique_ptr<Sorter> _sorter;
+
+    Sorter& acquire() {
+        if (!_sorter) _sorter = _pool.acquire();
+        return *_sorter;
+    }
+};
@@ -0,0 +1,181 @@
+/*
+ * PresortedSorter.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <foxxll/mng/read_write_pool.hpp>
+#include <stxxl/sequence>
+#include <stxxl/sorter>
+#include <tlx/die.hpp>
+
+/**
+ * Drop-in replacement for stxxl::sorter that additionally accepts items which
+ * are already sorted (push_sorted). Those bypass the sorter and are appended
+ * to an external sequence; when reading, both parts are merged. A producer
+ * that sorts in internal memory (e.g. the base case) thus saves the run
+ * formation and merging of the sorter.
+ *
+ * Only one presorted run is kept: an item passed to push_sorted that is
+ * smaller than the last presorted one (e.g. the start of a second base
+ * case's run) goes through the sorter instead, so the output stays sorted.
+ * The memory given to the constructor covers both the sorter and the
+ * blocks of the presorted sequence (SEQUENCE_MEM).
+ */
+template <typename ValueType, typename Comparator>
+class PresortedSorter {
+public:
+    using value_type = ValueType;
+    using cmp_type = Comparator;
+
+    static constexpr size_t SEQUENCE_BLOCK_SIZE = 512 * 1024;
+    // the sequence requires at least 3 write blocks and keeps a front and a back block of its own
+    static constexpr size_t SEQUENCE_WRITE_BLOCKS = 3;
+    static constexpr size_t SEQUENCE_PREFETCH_BLOCKS = 1;
+    static constexpr size_t SEQUENCE_MEM = (SEQUENCE_WRITE_BLOCKS + SEQUENCE_PREFETCH_BLOCKS + 2) * SEQUENCE_BLOCK_SIZE;
+
+private:
+    using sorter_type = stxxl::sorter<ValueType, Comparator>;
+    using sequence_type = stxxl::sequence<ValueType, SEQUENCE_BLOCK_SIZE>;
+    using pool_type = foxxll::read_write_pool<typename sequence_type::block_type>;
+    using reader_type = typename sequence_type::stream;
+
+    Comparator _cmp;
+    sorter_type _sorter;
+
+    pool_type _pool;
+    std::unique_ptr<sequence_type> _sorted;
+    std::unique_ptr<reader_type> _reader;
+    size_t _sorted_size = 0;
+    size_t _sorted_remaining = 0;
+    value_type _last_sorted{};
+
+    // whether the current item comes from the presorted sequence
+    bool _from_sorted = false;
+
+public:
+    PresortedSorter(const Comparator& cmp, size_t memory)
+    : _cmp(cmp), _sorter(cmp, sorter_mem(memory)),
+      _pool(SEQUENCE_PREFETCH_BLOCKS, SEQUENCE_WRITE_BLOCKS)
+    { }
+
+    PresortedSorter(const PresortedSorter&) = delete;
+    PresortedSorter& operator=(const PresortedSorter&) = delete;
+
+    ~PresortedSorter() {
+        // in this order ;)
+        _reader.reset(nullptr);
+        _sorted.reset(nullptr);
+    }
+
+    void push(const value_type& item) {
+        _sorter.push(item);
+    }
+
+    //! Appends to the presorted run; items smaller than the last one are sorted instead
+    void push_sorted(const value_type& item) {
+        assert(!_reader);
+        if (_sorted_size && _cmp(item, _last_sorted)) {
+            _sorter.push(item);
+            return;
+        }
+        if (!_sorted) {
+            _sorted = std::make_unique<sequence_type>(_pool, SEQUENCE_PREFETCH_BLOCKS);
+        }
+        _sorted->push_back(item);
+        _last_sorted = item;
+        ++_sorted_size;
+    }
+
+    void sort() {
+        _sorter.sort();
+        start_reading();
+    }
+
+    void sort_reuse() {
+        _sorter.sort_reuse();
+        start_reading();
+    }
+
+    void rewind() {
+        _sorter.rewind();
+        start_reading();
+    }
+
+    void clear() {
+        _sorter.clear();
+        clear_sorted();
+    }
+
+    void finish_clear() {
+        _sorter.finish_clear();
+        clear_sorted();
+    }
+
+    size_t size() const {
+        return _sorter.size() + (_reader ? _sorted_remaining : _sorted_size);
+    }
+
+    bool empty() const {
+        return _sorter.empty() && !_sorted_remaining;
+    }
+
+    const value_type& operator*() const {
+        assert(!empty());
+        return _from_sorted ? **_reader : *_sorter;
+    }
+
+    PresortedSorter& operator++() {
+        assert(!empty());
+        if (_from_sorted) {
+            ++(*_reader);
+            --_sorted_remaining;
+        } else {
+            ++_sorter;
+        }
+        choose();
+        return *this;
+    }
+
+private:
+    static size_t sorter_mem(size_t memory) {
+        die_unless(memory >= 2 * SEQUENCE_MEM);
+        return memory - SEQUENCE_MEM;
+    }
+
+    void start_reading() {
+        _reader.reset(nullptr);
+        if (_sorted) {
+            _reader = std::make_unique<reader_type>(_sorted->get_stream());
+        }
+        _sorted_remaining = _sorted_size;
+        choose();
+    }
+
+    void choose() {
+        _from_sorted = _sorted_remaining && (_sorter.empty() || _cmp(**_reader, *_sorter));
+    }
+
+    void clear_sorted() {
+        _reader.reset(nullptr);
+        _sorted.reset(nullptr);
+        _sorted_size = 0;
+        _sorted_remaining = 0;
+        _from_sorted = false;
+    }
+};
+
+//! Whether Sorter accepts already sorted runs through push_sorted
+template <typename Sorter, typename = void>
+struct accepts_presorted : std::false_type { };
+
+template <typename Sorter>
+struct accepts_presorted<Sorter, std::void_t<decltype(std::declval<Sorter&>().push_sorted(std::declval<const typename Sorter::value_type&>()))>>
+: std::true_type { };
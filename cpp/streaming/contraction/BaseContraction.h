@@ -7,4 +7,16 @@
 #ifndef EM_CC_BASECONTRACTION_H
 #define EM_CC_BASECONTRACTION_H
 
+#include "../../defs.hpp"
+
+/**
+ * Forest output of contractions whose spanning forest is not requested.
+ *
+ * Contractions supporting forests (supports_forest()) push one input edge
+ * per contracted node, such that these edges span every contracted group.
+ */
+struct ForestIgnorer {
+    void push(const edge_t&) { }
+};
+
 #endif //EM_CC_BASECONTRACTION_H
@@ -11,9 +11,11 @@
 #include <stxxl/sorter>
 #include "../../defs.hpp"
 #include "../hungdefs.hpp"
+#include "BaseContraction.h"
 #include "../relabelling/EdgeSorterRelabeller.h"
 #include "../transforms/make_unique_stream.h"
 #include "../transforms/make_consecutively_filtered_stream.h"
+#include "../utils/MemoryBudget.h"
 #include "../utils/StreamMerge.h"
 #include "../utils/StreamFilter.h"
 #include "../utils/StreamPusher.h"
@@ -98,8 +100,8 @@ class BoruvkaContraction {
 public:
     BoruvkaContraction() = default;
 
-    template <typename EdgesIn, typename ComponentsOut>
-    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& node_mapping, PipelinedKruskal& kruskal, size_t) {
+    template <typename EdgesIn, typename ComponentsOut, typename Kruskal>
+    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& node_mapping, Kruskal& kruskal, size_t) {
         tlx::unused(in_edges);
         tlx::unused(node_mapping);
         tlx::unused(kruskal);
@@ -107,11 +109,18 @@ public:
     }
 
     template <typename EdgesIn, typename EdgesOut, typename ComponentsOut>
-    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& out_edges, ComponentsOut& comp_labels, size_t) {
+    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& out_edges, ComponentsOut& comp_labels, size_t contraction_goal) {
+        ForestIgnorer no_forest;
+        compute_fully_external_contraction(in_edges, out_edges, comp_labels, no_forest, contraction_goal);
+    }
+
+    //! The minimum incident edges spanning the pseudo-trees are pushed to forest
+    template <typename EdgesIn, typename EdgesOut, typename ComponentsOut, typename ForestOut>
+    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& out_edges, ComponentsOut& comp_labels, ForestOut& forest, size_t) {
         assert(!in_edges.empty());
 
         // double the edges and sort them lexicographically
-        stxxl::sorter<edge_t, edge_less_cmp> bidir_edges(edge_less_cmp(), SORTER_MEM);
+        stxxl::sorter<edge_t, edge_less_cmp> bidir_edges(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
         for (; !in_edges.empty(); ++in_edges) {
             const auto edge = *in_edges;
             bidir_edges.push(edge_t{edge.u, edge.v});
@@ -121,7 +130,7 @@ public:
 
         // retrieve minimum incident neighbour
         node_t last_src = MAX_NODE;
-        stxxl::sorter<edge_t, edge_less_ordered_cmp> phase_edges(edge_less_ordered_cmp(), SORTER_MEM);
+        stxxl::sorter<edge_t, edge_less_ordered_cmp> phase_edges(edge_less_ordered_cmp(), MemoryBudget::instance().sorter_mem());
         for (; !bidir_edges.empty(); ++bidir_edges) {
             const auto dir_edge = *bidir_edges;
             const auto src = dir_edge.u;
@@ -143,15 +152,17 @@ public:
             return a1 == b1 && a2 == b2;
         };
 
-        stxxl::sorter<edge_t, edge_less_cmp> cycleless_edges_lex(edge_less_cmp(), SORTER_MEM);
-        stxxl::sorter<node_t, node_less_cmp> tree_roots(node_less_cmp(), SORTER_MEM);
+        stxxl::sorter<edge_t, edge_less_cmp> cycleless_edges_lex(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+        stxxl::sorter<node_t, node_less_cmp> tree_roots(node_less_cmp(), MemoryBudget::instance().sorter_mem());
         edge_t last_edge{MAX_NODE, MAX_NODE};
         for (; !phase_edges.empty(); ++phase_edges) {
             const auto edge = *phase_edges;
             if (seq_eq(edge, last_edge))
                 tree_roots.push(edge.v);
-            else
+            else {
                 cycleless_edges_lex.push(edge);
+                forest.push(edge.normalized());
+            }
 
             last_edge = edge;
         }
@@ -165,9 +176,9 @@ public:
         // construct sorted list of edges where after (u, v) we store all edges incident to v,
         // we send all incident edges to the position emitted by the edge (u, v), by a parallel scan
         // the resulting edge list is called L and is the result of merging the two sequences (L contains each edge twice)
-        using incident_edge_pos        = loaded_node_t<node_t>;
+        using incident_edge_pos        = node_pos_t;
         using incident_edge_pos_sorter = stxxl::sorter<incident_edge_pos, node_pos_less_cmp>;
-        incident_edge_pos_sorter inc_ep_sorter(node_pos_less_cmp(), SORTER_MEM);
+        incident_edge_pos_sorter inc_ep_sorter(node_pos_less_cmp(), MemoryBudget::instance().sorter_mem());
 
         using cycleless_edge_stream_type = make_consecutively_filtered_stream<decltype(phase_edges), decltype(seq_eq)>;
         phase_edges.rewind();
@@ -179,7 +190,7 @@ public:
         }
         inc_ep_sorter.sort_reuse();
 
-        stxxl::sorter<ranked_edge_t, ranked_edge_load_edge_less_cmp> incoming_incident_edges(ranked_edge_load_edge_less_cmp(), SORTER_MEM);
+        stxxl::sorter<ranked_edge_t, ranked_edge_load_edge_less_cmp> incoming_incident_edges(ranked_edge_load_edge_less_cmp(), MemoryBudget::instance().sorter_mem());
         while (!inc_ep_sorter.empty()) {
             const auto top_target_msg = *inc_ep_sorter;
             const auto top_target_node = top_target_msg.node;
@@ -244,7 +255,7 @@ public:
         using ReprMsgCmp      = BoruvkaContraction_details::repr_msg_pq_cmp;
         using repr_pq_type    = typename stxxl::PRIORITY_QUEUE_GENERATOR<ReprMsg, ReprMsgCmp, INTERNAL_PQ_MEM, 1>::result;
         using repr_block_type = typename repr_pq_type::block_type;
-        const auto PQ_POOL_MEM_HALF_BLOCKS = (PQ_POOL_MEM / 2) / repr_block_type::raw_size;
+        const auto PQ_POOL_MEM_HALF_BLOCKS = (MemoryBudget::instance().pq_pool_mem() / 2) / repr_block_type::raw_size;
         foxxll::read_write_pool<repr_block_type> repr_pool(PQ_POOL_MEM_HALF_BLOCKS, PQ_POOL_MEM_HALF_BLOCKS);
         repr_pq_type repr_pq(repr_pool);
 
@@ -301,7 +312,7 @@ public:
 
         // relabel sources
         in_edges.rewind();
-        edge_sorter_reverse_less_t src_updated_edges(edge_reverse_less_cmp(), SORTER_MEM);
+        edge_sorter_reverse_less_t src_updated_edges(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
         EdgeSorterSourceRelabeller(comp_labels, in_edges, src_updated_edges);
         src_updated_edges.sort_reuse();
 
@@ -322,6 +333,10 @@ public:
         return false;
     }
 
+    static constexpr bool supports_forest() {
+        return true;
+    }
+
     static double get_expected_contraction_ratio_upper_bound() {
         return 0.5;
     }
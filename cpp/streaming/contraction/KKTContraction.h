@@ -19,6 +19,7 @@
 #include "../basecase/PipelinedKruskal.h"
 #include "../merging/ComponentMerger.h"
 #include "../transforms/make_unique_stream.h"
+#include "../utils/MemoryBudget.h"
 
 class KKTContraction {
     using node_sorter_less_t            = stxxl::sorter<node_t, node_less_cmp>;
@@ -31,8 +32,8 @@ protected:
 public:
     KKTContraction() = default;
 
-    template <typename EdgesIn, typename ComponentsOut>
-    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& node_mapping, PipelinedKruskal& kruskal, size_t) {
+    template <typename EdgesIn, typename ComponentsOut, typename Kruskal>
+    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& node_mapping, Kruskal& kruskal, size_t) {
         tlx::unused(in_edges);
         tlx::unused(node_mapping);
         tlx::unused(kruskal);
@@ -49,8 +50,8 @@ public:
         using sorted_comps_type = node_cc_sorter_node_cc_less_t ;
 
         BoruvkaContraction fst_contraction;
-        sorted_edges_type fst_edges(edge_less_cmp(), SORTER_MEM);
-        sorted_comps_type fst_ccs(node_component_node_cc_less_cmp(), SORTER_MEM);
+        sorted_edges_type fst_edges(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+        sorted_comps_type fst_ccs(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
         fst_contraction.compute_fully_external_contraction(in_edges, fst_edges, fst_ccs, 0);
         fst_edges.sort();
         node_upper_bound = fst_contraction.get_node_upper_bound();
@@ -69,8 +70,8 @@ public:
 
         sorted_edges_unique_type fst_edges_uqe(fst_edges);
         BoruvkaContraction snd_contraction;
-        sorted_edges_type snd_edges(edge_less_cmp(), SORTER_MEM);
-        sorted_comps_type snd_ccs(node_component_node_cc_less_cmp(), SORTER_MEM);
+        sorted_edges_type snd_edges(edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+        sorted_comps_type snd_ccs(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
         snd_contraction.compute_fully_external_contraction(fst_edges_uqe, snd_edges, snd_ccs, 0);
         snd_edges.sort();
         node_upper_bound = snd_contraction.get_node_upper_bound();
@@ -82,7 +83,7 @@ public:
             std::cout << "no edges left after 2. contraction" << std::endl;
 
             // resort first component map to be sorted by component
-            node_cc_sorter_cc_node_less_t fst_ccs_srtd_cc_node_less(node_component_cc_node_less_cmp(), SORTER_MEM);
+            node_cc_sorter_cc_node_less_t fst_ccs_srtd_cc_node_less(node_component_cc_node_less_cmp(), MemoryBudget::instance().sorter_mem());
             StreamPusher(fst_ccs, fst_ccs_srtd_cc_node_less);
             fst_ccs_srtd_cc_node_less.sort_reuse();
             fst_ccs.finish_clear();
@@ -96,17 +97,17 @@ public:
         sorted_edges_unique_type snd_edges_uqe(snd_edges);
 
         BoruvkaContraction trd_contraction;
-        sorted_comps_type trd_ccs(node_component_node_cc_less_cmp(), SORTER_MEM);
+        sorted_comps_type trd_ccs(node_component_node_cc_less_cmp(), MemoryBudget::instance().sorter_mem());
         trd_contraction.compute_fully_external_contraction(snd_edges_uqe, contracted_edges, trd_ccs, 0);
         node_upper_bound = trd_contraction.get_node_upper_bound();
 
         std::cout << "3. contraction " << contracted_edges.size() << " " << trd_ccs.size() << std::endl;
 
-        node_cc_sorter_cc_node_less_t fst_ccs_by_ccnode(node_component_cc_node_less_cmp(), SORTER_MEM);
+        node_cc_sorter_cc_node_less_t fst_ccs_by_ccnode(node_component_cc_node_less_cmp(), MemoryBudget::instance().sorter_mem());
         StreamPusher(fst_ccs, fst_ccs_by_ccnode);
         fst_ccs_by_ccnode.sort_reuse();
 
-        node_cc_sorter_cc_node_less_t snd_ccs_by_ccnode(node_component_cc_node_less_cmp(), SORTER_MEM);
+        node_cc_sorter_cc_node_less_t snd_ccs_by_ccnode(node_component_cc_node_less_cmp(), MemoryBudget::instance().sorter_mem());
         StreamPusher(snd_ccs, snd_ccs_by_ccnode);
         snd_ccs_by_ccnode.sort_reuse();
 
@@ -129,6 +130,11 @@ public:
         return false;
     }
 
+    // the second and third contraction work on contracted ids, their edges would need lifting
+    static constexpr bool supports_forest() {
+        return false;
+    }
+
     static double get_expected_contraction_ratio_upper_bound() {
         return 0.125;
     }
@@ -6,55 +6,30 @@
 
 #pragma once
 
+#include <type_traits>
+
 #include <foxxll/mng/read_write_pool.hpp>
 #include <stxxl/priority_queue>
 
 #include "../../defs.hpp"
 #include "../../stream-checks.hpp"
 #include "../../stream-utils.hpp"
+#include "../hungdefs.hpp"
+#include "BaseContraction.h"
 #include "../containers/EdgeStream.h"
 #include "../containers/less_alloc_forward_sequence.h"
 #include "../transforms/make_unique_stream.h"
 #include "../basecase/PipelinedKruskal.h"
+#include "../utils/MemoryBudget.h"
 #include "../utils/StreamPusher.h"
 
-// note: this could be generalized significantly
-template <typename pq_type>
-class StreamMessagesForSource {
-public:
-	using value_type = node_t;
-private:
-	pq_type& pq;
-	value_type source;
-	value_type current;
-public:
-	StreamMessagesForSource(pq_type& pq_, const value_type source_) : pq(pq_), source(source_) {
-		if (!empty()) {
-			current = pq.top().v;
-		}
-	}
-
-	[[nodiscard]] bool empty() const {
-		return pq.empty() || pq.top().u != source;
-	}
-
-	const value_type& operator* () const {
-		return current;
-	}
-
-	StreamMessagesForSource& operator++ () {
-		pq.pop();
-		if (!empty()) {
-			current = pq.top().v;
-		}
-		return *this;
-	}
-};
+template <typename Message, typename edge_stream1, typename edge_stream2, typename edge_stream3, typename ForestOut>
+void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_stream2& output_tree, edge_stream3& output_edges, ForestOut& output_forest);
 
 class SibeynContraction {
 public:
-	template <typename EdgesIn, typename ComponentsOut>
-	void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& star_mapping, PipelinedKruskal& kruskal, size_t contraction_goal) {
+	template <typename EdgesIn, typename ComponentsOut, typename Kruskal>
+	void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& star_mapping, Kruskal& kruskal, size_t contraction_goal) {
 		EdgeStream tree_edges;
 		run_sibeyn_tuned(in_edges, contraction_goal, tree_edges, kruskal);
 		tree_edges.consume();
@@ -72,10 +47,24 @@ public:
 		tfp(reversed_tree_edges, star_mapping);
 	}
 
+	//! Pushes one input edge per contracted node to forest (see run_sibeyn_tuned)
+	template <typename EdgesIn, typename EdgesOut, typename ComponentsOut, typename ForestOut>
+	void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& contracted_edges, ComponentsOut& star_mapping, ForestOut& forest, size_t contraction_goal) {
+		EdgeStream tree_edges;
+		run_sibeyn_tuned<edge_loaded_edge_t>(in_edges, contraction_goal, tree_edges, contracted_edges, forest);
+		tree_edges.consume();
+		StreamEdgesOrientReverse reversed_tree_edges(tree_edges);
+		tfp(reversed_tree_edges, star_mapping);
+	}
+
 	static bool supports_only_map_return() {
 		return true;
 	}
 
+	static constexpr bool supports_forest() {
+		return true;
+	}
+
 	static double get_expected_contraction_ratio_upper_bound() {
 		// TODO: use contraction goal here
 		return 0.5;
@@ -88,7 +77,7 @@ void run_sibeyn(edge_stream1& input_edges, size_t contract_num, edge_stream2& ou
 	assert(is_sorted(input_edges, edge_lt_ordering()));
 	using pq_type = stxxl::PRIORITY_QUEUE_GENERATOR<edge_t, edge_gt_lt_ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
 	using block_type = pq_type::block_type;
-	const auto pool_half_mem = PQ_POOL_MEM / 2 / block_type::raw_size;
+	const auto pool_half_mem = MemoryBudget::instance().pq_pool_mem() / 2 / block_type::raw_size;
 	foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
 	pq_type pq(pool);
 	// only want to contract the first contraction_goal sources; find and insert all edges from them
@@ -112,7 +101,7 @@ void run_sibeyn(edge_stream1& input_edges, size_t contract_num, edge_stream2& ou
 	// now, *input_edges should point to the first edge _not_ inserted in pq
 
 	using edge_sorter = stxxl::sorter<edge_t, edge_lt_ordering>;
-	edge_sorter overshot_pq(edge_lt_ordering(), SORTER_MEM);
+	edge_sorter overshot_pq(edge_lt_ordering(), MemoryBudget::instance().sorter_mem());
 
 	edge_t prev = edge_t(MIN_NODE, MAX_NODE); // changes for every pop
 	node_t original_u = prev.u; // used to detect when we start processing a new node
@@ -170,18 +159,72 @@ void run_sibeyn(edge_stream1& input_edges, size_t contract_num, edge_stream2& ou
 	StreamPusher(merged, output_edges);
 }
 
-template <typename edge_stream1, typename edge_stream2, typename edge_stream3>
-void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_stream2& output_tree, edge_stream3& output_edges) {
+// same order as edge_gt_lt_ordering, ignoring the origin
+struct sibeyn_message_gt_lt_ordering {
+	bool operator() (const edge_loaded_edge_t& a, const edge_loaded_edge_t& b) const {
+		return a.u > b.u || (a.u == b.u && a.v < b.v);
+	}
+	edge_loaded_edge_t min_value() const {
+		return edge_loaded_edge_t{MAX_NODE, MIN_NODE, {MAX_NODE, MIN_NODE}};
+	}
+	edge_loaded_edge_t max_value() const {
+		return edge_loaded_edge_t{MIN_NODE, MAX_NODE, {MIN_NODE, MAX_NODE}};
+	}
+};
+
+// messages (x, t) of run_sibeyn_tuned; loaded messages carry an input edge between the subtrees of x and t
+template <typename Message>
+struct sibeyn_messages;
+
+template <>
+struct sibeyn_messages<edge_t> {
+	using ordering = edge_gt_lt_ordering;
+	static edge_t make(node_t x, node_t t, const edge_t&) {
+		return edge_t{x, t};
+	}
+	static edge_t origin(const edge_t& msg) {
+		return msg;
+	}
+};
+
+template <>
+struct sibeyn_messages<edge_loaded_edge_t> {
+	using ordering = sibeyn_message_gt_lt_ordering;
+	static edge_loaded_edge_t make(node_t x, node_t t, const edge_t& origin) {
+		return edge_loaded_edge_t{x, t, origin};
+	}
+	static edge_t origin(const edge_loaded_edge_t& msg) {
+		return msg.load;
+	}
+};
+
+/*
+ * Contracts the first contract_num sources of the sorted input, each to its furthest
+ * neighbour, and pushes the remaining edges and messages to output_edges.
+ *
+ * With edge_loaded_edge_t messages, it additionally outputs a spanning forest of the
+ * contracted nodes. A tree edge (u, t) found through a message is no input edge. Hence
+ * every message (x, t) carries an input edge between the subtrees of x and t at the time
+ * it is sent (a message forwarded on contraction keeps its edge). For every contracted
+ * node the input edge behind its tree edge is output; as the subtree of u is complete once
+ * u is processed, these edges span every tree.
+ */
+template <typename Message, typename edge_stream1, typename edge_stream2, typename edge_stream3, typename ForestOut>
+void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_stream2& output_tree, edge_stream3& output_edges, ForestOut& output_forest) {
+	constexpr bool with_forest = !std::is_same_v<ForestOut, ForestIgnorer>;
+	static_assert(!with_forest || !std::is_same_v<Message, edge_t>, "a spanning forest needs messages carrying their input edge");
+	using messages = sibeyn_messages<Message>;
+
 	// this version assumes that the input is sorted
 	assert(is_sorted(input_edges, edge_lt_ordering()));
-	using pq_type = stxxl::PRIORITY_QUEUE_GENERATOR<edge_t, edge_gt_lt_ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
-	using block_type = pq_type::block_type;
-	const auto pool_half_mem = (PQ_POOL_MEM / 2) / block_type::raw_size;
+	using pq_type = typename stxxl::PRIORITY_QUEUE_GENERATOR<Message, typename messages::ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
+	using block_type = typename pq_type::block_type;
+	const auto pool_half_mem = (MemoryBudget::instance().pq_pool_mem() / 2) / block_type::raw_size;
 	foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
 	pq_type pq(pool);
 	size_t contracted_nodes = 0;
 
-    stxxl::less_alloc_forward_sequence<node_t> neighbors_input;
+	stxxl::less_alloc_forward_sequence<node_t> neighbors_input;
 	while (!pq.empty() || !input_edges.empty()) {
 		// get next source
 		const node_t u_input = (!input_edges.empty() ? (*input_edges).u : MAX_NODE);
@@ -197,46 +240,50 @@ void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_strea
 		}
 		const node_t contraction_candidate_input = (!neighbors_input.empty() ? neighbors_input.back() : MIN_NODE);
 
-		// then look at pq
-		StreamMessagesForSource messages_in_pq(pq, u_current);
-		make_unique_stream unique_messages_in_pq(messages_in_pq);
-
-		// due to PQ order, first message has highest v
-		const node_t contraction_candidate_pq = (!unique_messages_in_pq.empty() ? *unique_messages_in_pq : MIN_NODE);
+		// then look at pq; due to PQ order, first message has highest v
+		const bool has_messages = (u_message == u_current);
+		const node_t contraction_candidate_pq = (has_messages ? pq.top().v : MIN_NODE);
 
-		// and take furthest neighbor found
+		// and take furthest neighbor found, preferring the input edge
 		const node_t v_contraction_target = std::max(contraction_candidate_input, contraction_candidate_pq);
 
 		// output the tree edge
 		output_tree.push(edge_t{u_current, v_contraction_target});
+		if constexpr (with_forest) {
+			if (contraction_candidate_input == v_contraction_target) {
+				output_forest.push(edge_t{u_current, v_contraction_target});
+			} else {
+				output_forest.push(messages::origin(pq.top()).normalized());
+			}
+		}
 
 		// and send signals
 		// first from original edges
 		for (auto input_neighbor_stream = neighbors_input.get_stream(); !input_neighbor_stream.empty(); ++input_neighbor_stream) {
-			const edge_t msg = edge_t{*input_neighbor_stream, v_contraction_target};
-			assert(msg.u <= msg.v);
-			assert(u_current < msg.u);
-			if (!msg.self_loop()) {
-				pq.push(msg);
+			const node_t neighbor = *input_neighbor_stream;
+			assert(u_current < neighbor);
+			if (neighbor != v_contraction_target) {
+				pq.push(messages::make(neighbor, v_contraction_target, edge_t{u_current, neighbor}));
 			}
 		}
-		// second from signals
-		for (; !unique_messages_in_pq.empty(); ++unique_messages_in_pq) {
-			const edge_t msg = edge_t{*unique_messages_in_pq, v_contraction_target};
-			assert(msg.u <= msg.v);
-			assert(u_current < msg.u);
-			if (!msg.self_loop()) {
-				pq.push(msg);
+		// second from signals, once per target
+		node_t prev_target = MAX_NODE;
+		while (!pq.empty() && pq.top().u == u_current) {
+			const Message msg = pq.top();
+			pq.pop();
+			if (msg.v == prev_target) continue;
+			prev_target = msg.v;
+			assert(msg.v <= v_contraction_target);
+			if (msg.v != v_contraction_target) {
+				pq.push(messages::make(msg.v, v_contraction_target, messages::origin(msg)));
 			}
 		}
 
+		neighbors_input.reset();
 		++contracted_nodes;
 		if (contracted_nodes == contract_num) {
-		    neighbors_input.reset();
 			break;
 		}
-
-		neighbors_input.reset();
 	}
 
 	// warning: not deduplicating between edges and signals (not necessary for Kruskal)
@@ -244,9 +291,8 @@ void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_strea
 		output_edges.push(*input_edges);
 	}
 	edge_t prev = edge_t(MIN_NODE, MAX_NODE);
-	edge_t current_edge = prev;
 	while (!pq.empty()) {
-		current_edge = pq.top();
+		const edge_t current_edge{pq.top().u, pq.top().v};
 		pq.pop();
 		if (current_edge == prev) {
 			continue;
@@ -256,25 +302,31 @@ void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_strea
 	}
 }
 
+template <typename edge_stream1, typename edge_stream2, typename edge_stream3>
+void run_sibeyn_tuned(edge_stream1& input_edges, size_t contract_num, edge_stream2& output_tree, edge_stream3& output_edges) {
+	ForestIgnorer no_forest;
+	run_sibeyn_tuned<edge_t>(input_edges, contract_num, output_tree, output_edges, no_forest);
+}
+
 template <typename edge_stream1, typename edge_stream2>
 void tfp(edge_stream1& input_tree, edge_stream2& output_stars) {
 	// assumes tree edges are oriented opposite from in sibeyn (e.g. larger-to-smaller)
 	// this version doesn't take existing star edges (e.g. from base case)
 	using pq_type = stxxl::PRIORITY_QUEUE_GENERATOR<edge_t, edge_lt_ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
 	using block_type = pq_type::block_type;
-	const auto pool_half_mem = PQ_POOL_MEM / 2 / block_type::raw_size;
+	const auto pool_half_mem = MemoryBudget::instance().pq_pool_mem() / 2 / block_type::raw_size;
 	foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
 	pq_type pq(pool);
 
 	using edge_reverse_sorter = stxxl::sorter<edge_t, edge_gt_ordering>;
 	// going "backwards" through tree edges
 	// TODO: probably handle this outside instead of flushing around
-	edge_reverse_sorter tree_reversed(edge_gt_ordering(), SORTER_MEM);
+	edge_reverse_sorter tree_reversed(edge_gt_ordering(), MemoryBudget::instance().sorter_mem());
 	flush(input_tree, tree_reversed);
 	tree_reversed.sort();
 	using edge_sorter = stxxl::sorter<edge_t, edge_lt_ordering>;
 	// want to output sorted edges
-	edge_sorter star_sorter(edge_lt_ordering(), SORTER_MEM);
+	edge_sorter star_sorter(edge_lt_ordering(), MemoryBudget::instance().sorter_mem());
 	edge_t msg;
 	node_t current_node = MAX_NODE;
 	node_t current_root = MAX_NODE;
@@ -316,7 +368,7 @@ void tfp_after_basecase(edge_stream1& input_tree, edge_stream2& input_stars, edg
 	// assumes tree edges are oriented opposite from in sibeyn (e.g. larger-to-smaller)
 	using pq_type = stxxl::PRIORITY_QUEUE_GENERATOR<edge_t, edge_lt_ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
 	using block_type = pq_type::block_type;
-	const auto pool_half_mem = PQ_POOL_MEM / 2 / block_type::raw_size;
+	const auto pool_half_mem = MemoryBudget::instance().pq_pool_mem() / 2 / block_type::raw_size;
 	foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
 	pq_type pq(pool);
 	for (; !input_stars.empty(); ++input_stars) {
@@ -327,12 +379,12 @@ void tfp_after_basecase(edge_stream1& input_tree, edge_stream2& input_stars, edg
 	using edge_reverse_sorter = stxxl::sorter<edge_t, edge_gt_ordering>;
 	// going "backwards" through tree edges
 	// TODO: probably handle this outside instead of flushing around
-	edge_reverse_sorter tree_reversed(edge_gt_ordering(), SORTER_MEM);
+	edge_reverse_sorter tree_reversed(edge_gt_ordering(), MemoryBudget::instance().sorter_mem());
 	flush(input_tree, tree_reversed);
 	tree_reversed.sort();
 	using edge_sorter = stxxl::sorter<edge_t, edge_lt_ordering>;
 	// want to output sorted edges
-	edge_sorter star_sorter(edge_lt_ordering(), SORTER_MEM);
+	edge_sorter star_sorter(edge_lt_ordering(), MemoryBudget::instance().sorter_mem());
 	edge_t msg;
 	node_t current_node = MAX_NODE;
 	node_t current_root = MAX_NODE;
@@ -10,7 +10,10 @@
 #include <stxxl/sorter>
 #include "../../defs.hpp"
 #include "../hungdefs.hpp"
+#include "BaseContraction.h"
+#include "../containers/EdgeStream.h"
 #include "../transforms/make_unique_stream.h"
+#include "../utils/MemoryBudget.h"
 #include "../utils/StreamFilter.h"
 #include "../utils/StreamRandomNeighbour.h"
 #include "../utils/StreamSplit.h"
@@ -35,8 +38,8 @@ class StarContraction {
 public:
     StarContraction() = default;
 
-    template <typename EdgesIn, typename ComponentsOut>
-    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& star_mapping, PipelinedKruskal& kruskal, size_t) {
+    template <typename EdgesIn, typename ComponentsOut, typename Kruskal>
+    void compute_semi_external_contraction(EdgesIn& in_edges, ComponentsOut& star_mapping, Kruskal& kruskal, size_t) {
         // TODO encapsulate
         //!!  get out-going edges
         // retrieve random out-edge for each source
@@ -48,7 +51,7 @@ public:
         // retrieve target nodes and split them off to sorter
         using rand_incident_edge_stream_type2 = StreamSplit<rand_incident_edge_stream_type, node_sorter_less_t, StarContraction_details::Project2ndEntry>;
         using target_stream_type = node_sorter_less_t;
-        target_stream_type targets(node_less_cmp(), SORTER_MEM);
+        target_stream_type targets(node_less_cmp(), MemoryBudget::instance().sorter_mem());
         rand_incident_edge_stream_type2 rand_incident_edges2(rand_incident_edges, targets, StarContraction_details::Project2ndEntry());
 
         // flush out target entries and sort
@@ -71,31 +74,24 @@ public:
         // update source nodes
         using source_updated_edges_stream_type = edge_sorter_reverse_less_t;
         to_contract_edges.rewind();
-        source_updated_edges_stream_type source_updated_edges(edge_reverse_less_cmp(), SORTER_MEM);
-        for (; !to_contract_edges.empty(); ++to_contract_edges) {
-            const edge_t edge = *to_contract_edges;
-            while (!star_edges.empty() && (*star_edges).u < edge.u) {
-                const auto star_edge = *star_edges;
-                star_mapping.push(node_component_t{star_edge.u, star_edge.v});
-                star_mapping.push(node_component_t{star_edge.v, star_edge.v});
-                ++star_edges;
-            }
-            if (!star_edges.empty() && (*star_edges).u == edge.u) {
-                const node_t new_source = (*star_edges).v;
-                if (new_source == edge.v) continue; // self loop
-                source_updated_edges.push(edge_t{new_source, edge.v});
-            } else {
-                source_updated_edges.push(edge);
-            }
-        }
-
-        // flush stream
+        source_updated_edges_stream_type source_updated_edges(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
         for (; !star_edges.empty(); ++star_edges) {
             const auto star_edge = *star_edges;
             star_mapping.push(node_component_t{star_edge.u, star_edge.v});
             star_mapping.push(node_component_t{star_edge.v, star_edge.v});
+
+            // edges of sources outside of stars are passed through run by run
+            forward_sources_below(to_contract_edges, star_edge.u, source_updated_edges);
+            for (; !to_contract_edges.empty() && (*to_contract_edges).u == star_edge.u; ++to_contract_edges) {
+                const edge_t edge = *to_contract_edges;
+                if (star_edge.v == edge.v) continue; // self loop
+                source_updated_edges.push(edge_t{star_edge.v, edge.v});
+            }
         }
 
+        // flush stream
+        forward_sources_below(to_contract_edges, MAX_NODE, source_updated_edges);
+
         // asserts
         assert(to_contract_edges.empty());
         assert(star_edges.empty());
@@ -126,7 +122,14 @@ public:
     }
 
     template <typename EdgesIn, typename EdgesOut, typename ComponentsOut>
-    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& contracted_edges, ComponentsOut& star_mapping, size_t) {
+    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& contracted_edges, ComponentsOut& star_mapping, size_t contraction_goal) {
+        ForestIgnorer no_forest;
+        compute_fully_external_contraction(in_edges, contracted_edges, star_mapping, no_forest, contraction_goal);
+    }
+
+    //! The star edges are pushed to forest
+    template <typename EdgesIn, typename EdgesOut, typename ComponentsOut, typename ForestOut>
+    void compute_fully_external_contraction(EdgesIn& in_edges, EdgesOut& contracted_edges, ComponentsOut& star_mapping, ForestOut& forest, size_t) {
         //!!  get out-going edges
         // retrieve random out-edge for each source
         using rand_incident_edge_stream_type = StreamRandomNeighbour<EdgesIn>;
@@ -137,7 +140,7 @@ public:
         // retrieve target nodes and split them off to sorter
         using rand_incident_edge_stream_type2 = StreamSplit<rand_incident_edge_stream_type, node_sorter_less_t, StarContraction_details::Project2ndEntry>;
         using target_stream_type = node_sorter_less_t;
-        target_stream_type targets(node_less_cmp(), SORTER_MEM);
+        target_stream_type targets(node_less_cmp(), MemoryBudget::instance().sorter_mem());
         rand_incident_edge_stream_type2 rand_incident_edges2(rand_incident_edges, targets, StarContraction_details::Project2ndEntry());
 
         // flush out target entries and sort
@@ -158,35 +161,29 @@ public:
         edge_t prev_edge(INVALID_NODE, INVALID_NODE);
 
         // update source nodes
-        edge_sorter_reverse_less_t source_updated_edges(edge_reverse_less_cmp(), SORTER_MEM);
+        edge_sorter_reverse_less_t source_updated_edges(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
         to_contract_edges.rewind();
-        for (; !to_contract_edges.empty(); ++to_contract_edges) {
-            const edge_t edge = *to_contract_edges;
-            while (!star_edges.empty() && (*star_edges).u < edge.u) {
-                const auto star_edge = *star_edges;
-                star_mapping.push(node_component_t{star_edge.u, star_edge.v});
-                star_mapping.push(node_component_t{star_edge.v, star_edge.v});
-                ++star_edges;
-            }
-            if (!star_edges.empty() && (*star_edges).u == edge.u) {
-                const node_t new_source = (*star_edges).v;
-                if (new_source == edge.v) continue; // self loop
-                source_updated_edges.push(edge_t{new_source, edge.v});
-            } else {
-                source_updated_edges.push(edge);
-            }
-        }
-
-        // asserts
-        assert(to_contract_edges.empty());
-
-        // flush star edges
         for (; !star_edges.empty(); ++star_edges) {
             const auto star_edge = *star_edges;
             star_mapping.push(node_component_t{star_edge.u, star_edge.v});
             star_mapping.push(node_component_t{star_edge.v, star_edge.v});
+            forest.push(star_edge.normalized());
+
+            // edges of sources outside of stars are passed through run by run
+            forward_sources_below(to_contract_edges, star_edge.u, source_updated_edges);
+            for (; !to_contract_edges.empty() && (*to_contract_edges).u == star_edge.u; ++to_contract_edges) {
+                const edge_t edge = *to_contract_edges;
+                if (star_edge.v == edge.v) continue; // self loop
+                source_updated_edges.push(edge_t{star_edge.v, edge.v});
+            }
         }
 
+        // flush stream
+        forward_sources_below(to_contract_edges, MAX_NODE, source_updated_edges);
+
+        // asserts
+        assert(to_contract_edges.empty());
+
         // sort source updated edges
         source_updated_edges.sort();
 
@@ -222,6 +219,10 @@ public:
         return true;
     }
 
+    static constexpr bool supports_forest() {
+        return true;
+    }
+
     static double get_expected_contraction_ratio_upper_bound() {
         return 0.75;
     }
@@ -0,0 +1,98 @@
+/*
+ * HyperLogLog.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#ifndef EM_CC_HYPERLOGLOG_H
+#define EM_CC_HYPERLOGLOG_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <tlx/math/clz.hpp>
+
+/**
+ * HyperLogLog distinct element estimator (Flajolet et al.) with linear
+ * counting for small counts. Its relative standard error is about
+ * 1.04 / sqrt(2^precision). Two estimators with the same seed and precision
+ * can be merged into one for the union of their elements.
+ */
+class HyperLogLog {
+public:
+    static constexpr unsigned MIN_PRECISION = 4;
+    static constexpr unsigned MAX_PRECISION = 18;
+
+    template <typename Gen>
+    HyperLogLog(Gen& gen, unsigned precision)
+     : seed(std::uniform_int_distribution<uint64_t>()(gen)),
+       precision(std::clamp(precision, MIN_PRECISION, MAX_PRECISION)),
+       registers(size_t(1) << this->precision, 0)
+    { }
+
+    //! Smallest precision whose standard error is at most error
+    static unsigned precision_for(double error) {
+        for (unsigned p = MIN_PRECISION; p < MAX_PRECISION; ++p) {
+            if (1.04 / std::sqrt(static_cast<double>(size_t(1) << p)) <= error) return p;
+        }
+        return MAX_PRECISION;
+    }
+
+    void operator() (uint64_t x) {
+        const uint64_t h = mix(x + seed);
+        const uint64_t rest = h << precision;
+        const uint8_t rank = static_cast<uint8_t>(rest ? tlx::clz(rest) + 1 : 64 - precision + 1);
+        auto& reg = registers[h >> (64 - precision)];
+        reg = std::max(reg, rank);
+    }
+
+    void merge(const HyperLogLog& other) {
+        assert(seed == other.seed && precision == other.precision);
+        for (size_t i = 0; i < registers.size(); ++i) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    double estimate() const {
+        const double m = static_cast<double>(registers.size());
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (const auto reg : registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(reg));
+            zeros += (reg == 0);
+        }
+        const double raw = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        if (raw <= 2.5 * m && zeros > 0) {
+            return m * std::log(m / static_cast<double>(zeros));
+        }
+        return raw;
+    }
+
+    size_t count() const {
+        return static_cast<size_t>(std::llround(estimate()));
+    }
+
+    double standard_error() const {
+        return 1.04 / std::sqrt(static_cast<double>(registers.size()));
+    }
+
+private:
+    const uint64_t seed;
+    const unsigned precision;
+    std::vector<uint8_t> registers;
+
+    // finalizer of MurmurHash3, spreads consecutive ids over all bits
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+#endif //EM_CC_HYPERLOGLOG_H
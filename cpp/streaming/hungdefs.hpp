@@ -152,6 +152,35 @@ inline std::ostream & operator << (std::ostream & os, const edge_loaded_edge_t &
     return os;
 }
 
+// relabelled edges that carry the edge they originate from as load
+struct edge_loaded_edge_less_cmp {
+    bool operator() (const edge_loaded_edge_t & a, const edge_loaded_edge_t & b) const {
+        return (a.u < b.u) || (a.u == b.u && a.v < b.v);
+    }
+
+    edge_loaded_edge_t min_value() const {
+        return edge_loaded_edge_t{MIN_NODE, MIN_NODE, {MIN_NODE, MIN_NODE}};
+    }
+
+    edge_loaded_edge_t max_value() const {
+        return edge_loaded_edge_t{MAX_NODE, MAX_NODE, {MAX_NODE, MAX_NODE}};
+    }
+};
+
+struct edge_loaded_edge_reverse_less_cmp {
+    bool operator() (const edge_loaded_edge_t & a, const edge_loaded_edge_t & b) const {
+        return (a.v < b.v) || (a.v == b.v && a.u < b.u);
+    }
+
+    edge_loaded_edge_t min_value() const {
+        return edge_loaded_edge_t{MIN_NODE, MIN_NODE, {MIN_NODE, MIN_NODE}};
+    }
+
+    edge_loaded_edge_t max_value() const {
+        return edge_loaded_edge_t{MAX_NODE, MAX_NODE, {MAX_NODE, MAX_NODE}};
+    }
+};
+
 template <typename T>
 class loaded_node_t {
 public:
@@ -183,7 +212,7 @@ struct node_pos_less_cmp {
     }
 
     node_pos_t max_value() const {
-        return node_pos_t{MAX_NODE, MAX_NODE};
+        return node_pos_t{MAX_NODE, std::numeric_limits<size_t>::max()};
     }
 };
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <type_traits>
+#include "../containers/EdgeStream.h"
 #include "../transforms/make_unique_stream.h"
 
 class EdgeSorterSourceRelabeller {
@@ -70,23 +71,16 @@ private:
         for (; !map_uqe.empty(); ++map_uqe) {
             const auto map_entry = *map_uqe;
             cb(map_entry);
-            for (; !edges.empty(); ++edges) {
+            forward_sources_below(edges, map_entry.node, updated_edges);
+            for (; !edges.empty() && (*edges).u == map_entry.node; ++edges) {
                 const auto edge = *edges;
-                if (edge.u < map_entry.node) {
-                    updated_edges.push(edge);
-                } else if (edge.u == map_entry.node) {
-                    if (map_entry.load == edge.v && skip_self_loops) continue;
-                    updated_edges.push(edge_t{map_entry.load, edge.v});
-                } else
-                    break;
+                if (map_entry.load == edge.v && skip_self_loops) continue;
+                updated_edges.push(edge_t{map_entry.load, edge.v});
             }
         }
 
         // flush out edges
-        for (; !edges.empty(); ++edges) {
-            const auto edge = *edges;
-            updated_edges.push(edge);
-        };
+        forward_sources_below(edges, MAX_NODE, updated_edges);
 
         // asserts
         assert(edges.empty());
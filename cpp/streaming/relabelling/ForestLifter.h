@@ -0,0 +1,87 @@
+/*
+ * ForestLifter.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <stxxl/sorter>
+#include "../hungdefs.hpp"
+#include "../transforms/make_unique_stream.h"
+#include "../utils/MemoryBudget.h"
+
+/**
+ * Maps the spanning forest of a relabelled graph back onto the edges it was
+ * relabelled from.
+ *
+ * The edges are relabelled with the node map exactly like the edge
+ * relabellers do (nodes without an entry keep their id), but every relabelled
+ * edge remembers its original. Joining with the forest then replaces each
+ * forest edge by one original edge between the two node groups it connects.
+ * Since the groups are connected by other means (e.g. the forest of a left
+ * subproblem or the star edges of a contraction), the result extends those
+ * to a spanning forest of the original edges.
+ */
+class ForestLifter {
+    using loaded_edge_sorter_reverse_less_t = stxxl::sorter<edge_loaded_edge_t, edge_loaded_edge_reverse_less_cmp>;
+    using loaded_edge_sorter_less_t         = stxxl::sorter<edge_loaded_edge_t, edge_loaded_edge_less_cmp>;
+
+public:
+    /**
+     * @param map     (node, representative), sorted by node; consumed twice
+     * @param edges   original edges sorted by source
+     * @param forest  forest over representatives, normalized and sorted
+     * @param out     receives one normalized original edge per forest edge
+     */
+    template <
+    typename NodeMapSorter,
+    typename InEdges,
+    typename InForest,
+    typename OutForest
+    >
+    ForestLifter(NodeMapSorter& map, InEdges& edges, InForest& forest, OutForest& out) {
+        static_assert(std::is_same<typename NodeMapSorter::value_type, node_component_t>::value,
+                      "Sorter requires value_type that contains (node, load).");
+        static_assert(std::is_same<typename NodeMapSorter::cmp_type, node_component_node_cc_less_cmp>::value,
+                      "Sorter requires cmp_type that sorts by (node).");
+
+        make_unique_stream<NodeMapSorter> map_uqe(map);
+
+        // relabel sources
+        loaded_edge_sorter_reverse_less_t upsrc(edge_loaded_edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
+        for (; !edges.empty(); ++edges) {
+            const edge_t edge = *edges;
+            while (!map_uqe.empty() && (*map_uqe).node < edge.u) ++map_uqe;
+            const node_t u = (!map_uqe.empty() && (*map_uqe).node == edge.u) ? (*map_uqe).load : edge.u;
+            if (u == edge.v) continue;
+            upsrc.push(edge_loaded_edge_t{u, edge.v, edge});
+        }
+        upsrc.sort();
+
+        // relabel targets
+        map_uqe.rewind();
+        loaded_edge_sorter_less_t relabelled(edge_loaded_edge_less_cmp(), MemoryBudget::instance().sorter_mem());
+        for (; !upsrc.empty(); ++upsrc) {
+            const edge_loaded_edge_t edge = *upsrc;
+            while (!map_uqe.empty() && (*map_uqe).node < edge.v) ++map_uqe;
+            const node_t v = (!map_uqe.empty() && (*map_uqe).node == edge.v) ? (*map_uqe).load : edge.v;
+            if (edge.u == v) continue;
+            const edge_t normalized = edge_t{edge.u, v}.normalized();
+            relabelled.push(edge_loaded_edge_t{normalized.u, normalized.v, edge.load});
+        }
+        upsrc.finish_clear();
+        relabelled.sort();
+
+        // join, every forest edge stems from at least one relabelled edge
+        const edge_less_cmp less;
+        for (; !forest.empty(); ++forest) {
+            const edge_t forest_edge = *forest;
+            for (; !relabelled.empty() && less(edge_t((*relabelled).u, (*relabelled).v), forest_edge); ++relabelled);
+            const bool found = !relabelled.empty() && (*relabelled).u == forest_edge.u && (*relabelled).v == forest_edge.v;
+            die_unless(found);
+            out.push((*relabelled).load.normalized());
+        }
+    }
+};
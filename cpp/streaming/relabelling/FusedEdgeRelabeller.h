@@ -0,0 +1,219 @@
+/*
+ * FusedEdgeRelabeller.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <stxxl/priority_queue>
+#include <stxxl/sorter>
+#include "../containers/EdgeStream.h"
+#include "../transforms/make_unique_stream.h"
+#include "../utils/MemoryBudget.h"
+#include "EdgeSorterRelabeller.h"
+
+/**
+ * Relabels sources and targets of edges in a single scan, instead of the
+ * source relabelling, sort by target and target relabelling of the
+ * EdgeSorterSourceRelabeller and EdgeSorterTargetRelabeller.
+ *
+ * If the node map fits into the given memory, it is loaded and both
+ * endpoints are looked up. Otherwise the map and the edges are merged by
+ * source, and every source relabelled edge is sent forward in time to its
+ * target through a priority queue, to be relabelled when the map reaches the
+ * target. Edges whose target lies before their source cannot be sent forward;
+ * they are collected and relabelled by an additional pass over the map, which
+ * only happens for edges that are not normalized.
+ *
+ * The map entries are passed on to out_map, and the relabelled edges are
+ * pushed normalized and in no particular order to updated_edges, which may
+ * therefore be a sorter in the order of the next stage or a base case.
+ * Nodes without an entry keep their id and self-loops are dropped.
+ */
+class FusedEdgeRelabeller {
+    // messages (target, relabelled source), smallest target first
+    using message_pq_t         = stxxl::PRIORITY_QUEUE_GENERATOR<edge_t, edge_gt_ordering, INTERNAL_PQ_MEM, MAX_PQ_SIZE>::result;
+    using backward_sorter_t    = stxxl::sorter<edge_t, edge_reverse_less_cmp>;
+
+public:
+    template <
+    typename NodeMapSorter,
+    typename OutNodeMapSorter,
+    typename InEdges,
+    typename OutEdges
+    >
+    FusedEdgeRelabeller(NodeMapSorter& map, OutNodeMapSorter& out_map, InEdges& edges, OutEdges& updated_edges, size_t semi_external_mem) {
+        static_assert(std::is_same<typename NodeMapSorter::value_type, node_component_t>::value,
+                      "Sorter requires value_type that contains (node, load).");
+        static_assert(std::is_same<typename NodeMapSorter::cmp_type, node_component_node_cc_less_cmp>::value,
+                      "Sorter requires cmp_type that sorts by (node).");
+        static_assert(std::is_same<typename OutNodeMapSorter::value_type, node_component_t>::value,
+                      "Sorter requires value_type that contains (node, load).");
+        static_assert(std::is_same<typename OutNodeMapSorter::cmp_type, node_component_cc_node_less_cmp>::value,
+                      "Sorter requires cmp_type that sorts by (cc, node).");
+        static_assert(std::is_same<typename InEdges::value_type, edge_t>::value,
+                      "Edges require value_type (node, node).");
+
+        // the loaded map and a bit per entry for the distinct nodes
+        if (map.size() * (sizeof(node_component_t) + 1) <= semi_external_mem) {
+            _semi_external = true;
+            relabel_semi_external(map, out_map, edges, updated_edges);
+        } else {
+            relabel_time_forward(map, out_map, edges, updated_edges);
+        }
+
+        // asserts
+        assert(edges.empty());
+    }
+
+    //! Upper bound on the number of nodes of the relabelled edges
+    node_t node_upp_bnd() const {
+        return _node_upp_bnd;
+    }
+
+    bool semi_external() const {
+        return _semi_external;
+    }
+
+private:
+    node_t _node_upp_bnd = 0;
+    bool _semi_external = false;
+
+    template <typename NodeMapSorter, typename OutNodeMapSorter, typename InEdges, typename OutEdges>
+    void relabel_semi_external(NodeMapSorter& map, OutNodeMapSorter& out_map, InEdges& edges, OutEdges& updated_edges) {
+        std::vector<node_component_t> entries;
+        entries.reserve(map.size());
+        for (make_unique_stream<NodeMapSorter> map_uqe(map); !map_uqe.empty(); ++map_uqe) {
+            entries.push_back(*map_uqe);
+            out_map.push(entries.back());
+        }
+
+        // mapped nodes are counted once by their bit, unmapped ones once
+        // when the messages (node, source) leave the queue in node order
+        using block_type = message_pq_t::block_type;
+        const auto pool_half_mem = MemoryBudget::instance().pq_pool_mem() / 2 / block_type::raw_size;
+        foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
+        message_pq_t unmapped(pool);
+        node_t last_unmapped = MAX_NODE;
+        auto count_unmapped = [&](node_t node) {
+            for (; !unmapped.empty() && unmapped.top().u < node; unmapped.pop()) {
+                // a target before its source may be counted again, still a bound
+                _node_upp_bnd += (last_unmapped != unmapped.top().u);
+                last_unmapped = unmapped.top().u;
+            }
+        };
+        std::vector<bool> node_seen(entries.size(), false);
+        auto count_mapped = [&](std::vector<node_component_t>::const_iterator entry) {
+            const size_t index = static_cast<size_t>(entry - entries.cbegin());
+            _node_upp_bnd += !node_seen[index];
+            node_seen[index] = true;
+        };
+
+        // sources are merged with the entries, targets are looked up
+        auto source_entry = entries.cbegin();
+        node_t last_source = MAX_NODE;
+        node_t source = MAX_NODE;
+        for (; !edges.empty(); ++edges) {
+            const auto edge = *edges;
+            if (edge.u != last_source) {
+                last_source = edge.u;
+                count_unmapped(edge.u);
+                for (; source_entry != entries.cend() && source_entry->node < edge.u; ++source_entry);
+                if (source_entry != entries.cend() && source_entry->node == edge.u) {
+                    source = source_entry->load;
+                    count_mapped(source_entry);
+                } else {
+                    source = edge.u;
+                    unmapped.push(edge_t{edge.u, edge.u});
+                }
+            }
+
+            node_t target = edge.v;
+            const auto target_entry = std::lower_bound(entries.cbegin(), entries.cend(), node_component_t{edge.v, 0}, node_component_node_cc_less_cmp());
+            if (target_entry != entries.cend() && target_entry->node == edge.v) {
+                target = target_entry->load;
+                count_mapped(target_entry);
+            } else {
+                unmapped.push(edge_t{edge.v, edge.u});
+            }
+
+            if (source == target) continue;
+            updated_edges.push(edge_t{source, target}.normalized());
+        }
+        count_unmapped(MAX_NODE);
+        assert(unmapped.empty());
+    }
+
+    template <typename NodeMapSorter, typename OutNodeMapSorter, typename InEdges, typename OutEdges>
+    void relabel_time_forward(NodeMapSorter& map, OutNodeMapSorter& out_map, InEdges& edges, OutEdges& updated_edges) {
+        using block_type = message_pq_t::block_type;
+        const auto pool_half_mem = MemoryBudget::instance().pq_pool_mem() / 2 / block_type::raw_size;
+        foxxll::read_write_pool<block_type> pool(pool_half_mem, pool_half_mem);
+        message_pq_t messages(pool);
+        std::unique_ptr<backward_sorter_t> backward_edges;
+
+        node_t last_source = MAX_NODE;
+        node_t last_target = MAX_NODE;
+
+        // relabels the source and sends the edge to its target
+        auto forward = [&](const edge_t& edge, node_t source) {
+            _node_upp_bnd += (last_source != edge.u);
+            last_source = edge.u;
+            if (TLX_LIKELY(edge.u < edge.v)) {
+                messages.push(edge_t{edge.v, source});
+                return;
+            }
+            if (edge.u == edge.v || source == edge.v) return;
+            if (!backward_edges) {
+                backward_edges = std::make_unique<backward_sorter_t>(edge_reverse_less_cmp(), MemoryBudget::instance().sorter_mem());
+            }
+            backward_edges->push(edge_t{source, edge.v});
+        };
+
+        // delivers the messages to targets below node, those at node get its load
+        auto deliver = [&](node_t node, node_t load) {
+            for (; !messages.empty() && messages.top().u <= node; messages.pop()) {
+                const auto message = messages.top();
+                _node_upp_bnd += (last_target != message.u);
+                last_target = message.u;
+                const node_t target = (message.u == node ? load : message.u);
+                if (message.v == target) continue;
+                updated_edges.push(edge_t{message.v, target}.normalized());
+            }
+        };
+
+        make_unique_stream<NodeMapSorter> map_uqe(map);
+        for (; !map_uqe.empty(); ++map_uqe) {
+            const auto map_entry = *map_uqe;
+            out_map.push(map_entry);
+
+            for (; !edges.empty() && (*edges).u < map_entry.node; ++edges) {
+                forward(*edges, (*edges).u);
+            }
+            deliver(map_entry.node, map_entry.load);
+            for (; !edges.empty() && (*edges).u == map_entry.node; ++edges) {
+                forward(*edges, map_entry.load);
+            }
+        }
+
+        // flush out edges and messages
+        for (; !edges.empty(); ++edges) {
+            forward(*edges, (*edges).u);
+        }
+        deliver(MAX_NODE, MAX_NODE);
+        assert(messages.empty());
+
+        if (backward_edges) {
+            backward_edges->sort();
+            // bounded by the number of these edges
+            _node_upp_bnd += backward_edges->size();
+            map.rewind();
+            EdgeSorterTargetRelabeller(map, *backward_edges, updated_edges);
+        }
+    }
+};
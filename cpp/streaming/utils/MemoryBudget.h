@@ -0,0 +1,262 @@
+/*
+ * MemoryBudget.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include <tlx/die.hpp>
+#include "../../defs.hpp"
+#include "../containers/EdgeStreamPool.h"
+
+/**
+ * Process-wide split of the memory given on the command line.
+ *
+ * Once configured, a fixed share of the budget is set aside for the buffers
+ * of external-memory structures and the rest is left to the semi-external
+ * base case. Of the buffer share, a quarter goes to the EdgeStreamPool.
+ * Structures that live through the whole run (e.g. the component maps of
+ * every recursion level) reserve their memory as long as they exist, as do
+ * those that outlive a phase, sized by the level of their data. Every
+ * sorter or priority queue pool created on the fly gets a part of what is not
+ * reserved, depending on how many of them the active phase keeps alive at
+ * the same time.
+ *
+ * stxxl needs a minimum per sorter and pool (MIN_SORTER_MEM, MIN_PQ_POOL_MEM).
+ * These floors are part of the budget: if the buffer share cannot hold them
+ * for the first level and the busiest phase, the base case gets less; if a
+ * deep recursion later leaves too little for them, the run fails instead of
+ * allocating more than provisioned. The presorted sequences of the component
+ * sorters are part of their sorter memory, the union-find of the base case is
+ * part of its share.
+ * Unconfigured, the compile-time defaults of defs.hpp are handed out.
+ */
+class MemoryBudget {
+public:
+    enum class phase_t { idle, contraction, relabelling, basecase, merging, lifting };
+
+    // the buffers of external-memory structures get a share of 1/BUFFER_SHARE_DIVISOR
+    static constexpr size_t BUFFER_SHARE_DIVISOR = 4;
+    // each level sorter reserves 1/LEVEL_SORTER_DIVISOR of the buffer share
+    static constexpr size_t LEVEL_SORTER_DIVISOR = 32;
+    // stxxl needs a few blocks per sorter and pool, so at least this much is handed out
+    static constexpr size_t MIN_SORTER_MEM = 16 * UIntScale::Mi;
+    static constexpr size_t MIN_PQ_POOL_MEM = 8 * UIntScale::Mi;
+    // the most sorters and pools a phase keeps alive at once, see concurrent_structures
+    static constexpr size_t MAX_CONCURRENT_STRUCTURES = 4;
+    // the two component sorters of the first level and the structures of the busiest phase
+    static constexpr size_t MIN_STRUCTURE_MEM = (2 + MAX_CONCURRENT_STRUCTURES) * MIN_SORTER_MEM;
+
+    static MemoryBudget& instance() {
+        static MemoryBudget budget;
+        return budget;
+    }
+
+    /**
+     * Splits bytes between the base case and the buffers; should happen before
+     * anything is reserved. stream_pool_bytes overrides the share of the
+     * EdgeStreamPool and is taken from the buffers as well.
+     */
+    void set_budget(size_t bytes, size_t stream_pool_bytes = 0) {
+        assert(_reserved == 0);
+        const size_t share = bytes / BUFFER_SHARE_DIVISOR;
+        _stream_pool = std::max(stream_pool_bytes ? stream_pool_bytes : share / 4, EdgeStreamPool::kMinBudget);
+        _structures = std::max(share - std::min(share, _stream_pool), MIN_STRUCTURE_MEM);
+        _buffers = _stream_pool + _structures;
+        if (_buffers >= bytes) {
+            die("Memory budget of " << bytes / UIntScale::Mi << " MiB does not exceed the minimal buffers of "
+                << _buffers / UIntScale::Mi << " MiB");
+        }
+        _total = bytes;
+        _configured = true;
+    }
+
+    //! Back to the compile-time defaults; nothing may be reserved
+    void clear_budget() {
+        assert(_reserved == 0);
+        _total = _buffers = _stream_pool = _structures = 0;
+        _configured = false;
+    }
+
+    bool configured() const {
+        return _configured;
+    }
+
+    size_t budget() const {
+        return _total;
+    }
+
+    //! Memory left to the semi-external base case
+    size_t basecase_mem() const {
+        return _total - _buffers;
+    }
+
+    size_t stream_pool_mem() const {
+        return (_configured ? _stream_pool : EDGE_STREAM_POOL_MEM);
+    }
+
+    //! Memory for a sorter that lives through the whole run; to be reserved by the caller
+    size_t level_sorter_mem() const {
+        return (_configured ? std::max(_structures / LEVEL_SORTER_DIVISOR, MIN_SORTER_MEM) : SORTER_MEM);
+    }
+
+    /**
+     * Memory for a sorter that outlives the phase it is created in and holds data
+     * of the given recursion level; to be reserved by the caller. The data of a
+     * level shrinks geometrically with its depth and so does this memory, which
+     * keeps their sum over all levels below twice that of the first, apart from
+     * the floors of the deep levels.
+     */
+    size_t level_data_sorter_mem(size_t level) const {
+        if (!_configured) return SORTER_MEM;
+        const size_t first_level = _structures / LEVEL_SORTER_DIVISOR;
+        return std::max(level < 8 * sizeof(size_t) ? first_level >> level : 0, MIN_SORTER_MEM);
+    }
+
+    //! Memory for a sorter created now
+    size_t sorter_mem() const {
+        return (_configured ? share(MIN_SORTER_MEM) : SORTER_MEM);
+    }
+
+    //! Memory for the block pool of a priority queue created now
+    size_t pq_pool_mem() const {
+        return (_configured ? share(MIN_PQ_POOL_MEM) : PQ_POOL_MEM);
+    }
+
+    void reserve(size_t bytes) {
+        _reserved += bytes;
+        if (_configured && _reserved > _structures) {
+            die("Memory budget exhausted: " << _reserved / UIntScale::Mi << " MiB reserved of "
+                << _structures / UIntScale::Mi << " MiB for sorters and priority queues");
+        }
+    }
+
+    void release(size_t bytes) {
+        assert(bytes <= _reserved);
+        _reserved -= bytes;
+    }
+
+    size_t reserved() const {
+        return _reserved;
+    }
+
+    phase_t phase() const {
+        return _phase;
+    }
+
+    //! Returns the previous phase, see MemoryPhase
+    phase_t enter(phase_t phase) {
+        return std::exchange(_phase, phase);
+    }
+
+private:
+    size_t _total = 0;
+    size_t _buffers = 0;
+    size_t _stream_pool = 0;
+    size_t _structures = 0; // _buffers without the stream pool
+    size_t _reserved = 0;
+    bool _configured = false;
+    phase_t _phase = phase_t::idle;
+
+    MemoryBudget() = default;
+
+    // the unreserved buffer memory, split among the structures the phase holds at once; at least floor each
+    size_t share(size_t floor) const {
+        const size_t unreserved = _structures - std::min(_reserved, _structures);
+        const size_t share = unreserved / concurrent_structures(_phase);
+        if (share < floor) {
+            die("Memory budget exhausted: " << unreserved / UIntScale::Mi << " MiB left for "
+                << concurrent_structures(_phase) << " sorters or priority queues of at least "
+                << floor / UIntScale::Mi << " MiB each");
+        }
+        return share;
+    }
+
+    static size_t concurrent_structures(phase_t phase) {
+        switch (phase) {
+            case phase_t::contraction: return MAX_CONCURRENT_STRUCTURES; // e.g. pq pool, overshoot, tree and star sorters
+            case phase_t::relabelling: return 3;
+            case phase_t::basecase:    return 2; // components and forest
+            case phase_t::merging:     return 3;
+            case phase_t::lifting:     return MAX_CONCURRENT_STRUCTURES;
+            default:                   return MAX_CONCURRENT_STRUCTURES;
+        }
+    }
+};
+
+//! Marks the active phase of the MemoryBudget for its lifetime
+class MemoryPhase {
+public:
+    explicit MemoryPhase(MemoryBudget::phase_t phase)
+    : _previous(MemoryBudget::instance().enter(phase))
+    {}
+
+    MemoryPhase(const MemoryPhase&) = delete;
+    MemoryPhase& operator=(const MemoryPhase&) = delete;
+
+    ~MemoryPhase() {
+        MemoryBudget::instance().enter(_previous);
+    }
+
+private:
+    const MemoryBudget::phase_t _previous;
+};
+
+//! Memory reserved in the MemoryBudget; released on reset or destruction
+class MemoryReservation {
+public:
+    MemoryReservation() = default;
+
+    explicit MemoryReservation(size_t bytes)
+    : _bytes(bytes)
+    {MemoryBudget::instance().reserve(bytes);}
+
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+    MemoryReservation(MemoryReservation&& other) noexcept
+    : _bytes(std::exchange(other._bytes, 0))
+    {}
+
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept {
+        if (this != &other) {
+            reset();
+            _bytes = std::exchange(other._bytes, 0);
+        }
+        return *this;
+    }
+
+    ~MemoryReservation() {
+        reset();
+    }
+
+    void add(size_t bytes) {
+        MemoryBudget::instance().reserve(bytes);
+        _bytes += bytes;
+    }
+
+    void remove(size_t bytes) {
+        assert(bytes <= _bytes);
+        MemoryBudget::instance().release(bytes);
+        _bytes -= bytes;
+    }
+
+    void reset() {
+        if (_bytes) {
+            MemoryBudget::instance().release(_bytes);
+            _bytes = 0;
+        }
+    }
+
+    size_t bytes() const {
+        return _bytes;
+    }
+
+private:
+    size_t _bytes = 0;
+};
@@ -0,0 +1,89 @@
+/*
+ * ParallelRadixSort.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ * Least significant digit radix sort of data[0, n) by an unsigned integer key.
+ *
+ * Every pass distributes 8 bits; passes over bytes above the largest key are
+ * skipped. Each thread counts and scatters a contiguous chunk, so the sort
+ * is stable. buffer must hold n elements; the result ends up in data.
+ */
+template <typename T, typename KeyFn>
+void parallel_radix_sort(T* data, T* buffer, size_t n, KeyFn key,
+                         size_t num_threads = std::thread::hardware_concurrency()) {
+    constexpr unsigned kDigitBits = 8;
+    constexpr size_t kBuckets = size_t{1} << kDigitBits;
+    constexpr size_t kMinElementsPerThread = 1 << 16;
+
+    if (n < 2) return;
+    num_threads = std::clamp<size_t>(num_threads, 1, (n + kMinElementsPerThread - 1) / kMinElementsPerThread);
+
+    uint64_t max_key = 0;
+    for (size_t i = 0; i < n; ++i) {
+        max_key = std::max<uint64_t>(max_key, key(data[i]));
+    }
+
+    using histogram_t = std::array<size_t, kBuckets>;
+    std::vector<histogram_t> offsets(num_threads);
+    auto chunk_begin = [&](size_t t) { return n * t / num_threads; };
+
+    auto for_each_chunk = [&](auto&& fn) {
+        if (num_threads == 1) {
+            fn(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back(fn, t);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    T* in = data;
+    T* out = buffer;
+    for (unsigned shift = 0; shift < 64 && (max_key >> shift); shift += kDigitBits) {
+        for_each_chunk([&](size_t t) {
+            histogram_t& count = offsets[t];
+            count.fill(0);
+            for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                ++count[(key(in[i]) >> shift) & (kBuckets - 1)];
+            }
+        });
+
+        // exclusive prefix sum in (digit, thread) order
+        size_t sum = 0;
+        for (size_t digit = 0; digit < kBuckets; ++digit) {
+            for (size_t t = 0; t < num_threads; ++t) {
+                const size_t count = offsets[t][digit];
+                offsets[t][digit] = sum;
+                sum += count;
+            }
+        }
+
+        for_each_chunk([&](size_t t) {
+            histogram_t& pos = offsets[t];
+            for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                out[pos[(key(in[i]) >> shift) & (kBuckets - 1)]++] = in[i];
+            }
+        });
+
+        std::swap(in, out);
+    }
+
+    if (in != data) {
+        std::copy(in, in + n, data);
+    }
+}
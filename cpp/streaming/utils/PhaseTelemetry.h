@@ -0,0 +1,87 @@
+/*
+ * PhaseTelemetry.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <fstream>
+#include <string>
+
+//! Measurements of one phase of a subproblem
+struct phase_record_t {
+    unsigned level;
+    bool left;
+    const char* phase;       // contraction, sampling, relabelling, basecase, merging, lifting or subproblem
+    const char* branch;      // optimization or variant the phase took, empty for the regular one
+    size_t nodes_in;         // node upper bound before the phase
+    size_t edges_in;
+    size_t nodes_out;        // node upper bound of the result
+    size_t edges_out;
+    size_t nodes_actual;     // nodes found, if the phase counts them (base case and subproblem), otherwise 0
+    double elapsed;          // seconds
+    double io_wait;          // seconds
+    size_t read_bytes;
+    size_t written_bytes;
+};
+
+/**
+ * Process-wide sink for phase measurements, one line per phase.
+ *
+ * Writes CSV with a header if the file name ends in .csv and JSON lines
+ * otherwise. Records are only formatted into the buffer of the file, so
+ * recording costs a few hundred bytes of output per phase; unopened, it
+ * costs nothing but the check in enabled(). Not thread-safe, phases are
+ * recorded by the thread driving the recursion.
+ */
+class PhaseTelemetry {
+public:
+    static PhaseTelemetry& instance() {
+        static PhaseTelemetry telemetry;
+        return telemetry;
+    }
+
+    //! Starts recording to path; returns false if the file cannot be written
+    bool open(const std::string& path) {
+        _out.open(path, std::ios::out | std::ios::trunc);
+        if (!_out) return false;
+        _csv = (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0);
+        if (_csv) {
+            _out << "level,side,phase,branch,nodes_in,edges_in,nodes_out,edges_out,nodes_actual,elapsed,io_wait,read_bytes,written_bytes\n";
+        }
+        return true;
+    }
+
+    bool enabled() const {
+        return _out.is_open();
+    }
+
+    void record(const phase_record_t& record) {
+        if (!enabled()) return;
+        const char* side = (record.left ? "left" : "right");
+        if (_csv) {
+            _out << record.level << ',' << side << ',' << record.phase << ',' << record.branch << ','
+                 << record.nodes_in << ',' << record.edges_in << ',' << record.nodes_out << ',' << record.edges_out << ','
+                 << record.nodes_actual << ',' << record.elapsed << ',' << record.io_wait << ','
+                 << record.read_bytes << ',' << record.written_bytes << '\n';
+        } else {
+            _out << "{\"level\":" << record.level << ",\"side\":\"" << side << "\",\"phase\":\"" << record.phase
+                 << "\",\"branch\":\"" << record.branch << "\",\"nodes_in\":" << record.nodes_in
+                 << ",\"edges_in\":" << record.edges_in << ",\"nodes_out\":" << record.nodes_out
+                 << ",\"edges_out\":" << record.edges_out << ",\"nodes_actual\":" << record.nodes_actual
+                 << ",\"elapsed\":" << record.elapsed << ",\"io_wait\":" << record.io_wait
+                 << ",\"read_bytes\":" << record.read_bytes << ",\"written_bytes\":" << record.written_bytes << "}\n";
+        }
+    }
+
+    void close() {
+        if (enabled()) _out.close();
+    }
+
+private:
+    std::ofstream _out;
+    bool _csv = false;
+
+    PhaseTelemetry() = default;
+};
@@ -22,10 +22,21 @@ int main(int argc, char *argv[]) {
 	}
 
 	foxxll::scoped_print_iostats global_stats("total");
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDWR | foxxll::file::DIRECT);
-	em_edge_vector E(input_file);
+	const bool with_header = read_graph_header(input_filename).has_header();
+	em_edge_vector E;
+	read_graph(input_filename, E);
 	std::mt19937_64 gen(std::random_device{}());
 	auto n_rand = to_stxxl_rand(gen);
 
-	stxxl::random_shuffle(E.begin(), E.end(), n_rand, INTERNAL_SORT_MEM);
+	{
+		foxxll::scoped_print_iostats shuffle_stats("shuffle");
+		stxxl::random_shuffle(E.begin(), E.end(), n_rand, INTERNAL_SORT_MEM);
+	}
+
+	// overwrite the input, keeping its format
+	GraphWriter out(input_filename, with_header);
+	for (const auto& e : E) {
+		out.push(e);
+	}
+	out.close();
 }
@@ -35,8 +35,8 @@ int main(int argc, char *argv[]) {
 	}
 
 	foxxll::scoped_print_iostats global_stats("total");
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector E(input_file);
+	em_edge_vector E;
+	read_graph(input_filename, E);
 	em_edge_vector sorted;
 	sorted.resize(E.size());
 	std::cout << "Have mapped vector of " << E.size() << " edges" << std::endl;
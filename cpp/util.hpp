@@ -1,68 +1,477 @@
 #pragma once
 
+#include <foxxll/common/aligned_alloc.hpp>
 #include <foxxll/io.hpp>
+#include <cstring>
+#include <condition_variable>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 #include <stxxl/sort>
+#include <tlx/die.hpp>
 #include "defs.hpp"
 #include "robin_hood.h"
 
+namespace read_graph_details {
+	struct chunk_result {
+		size_t num_kept = 0;
+		size_t num_parallel = 0;
+		size_t num_unordered = 0;
+		size_t num_invalid = 0;
+	};
+
+	// narrows the file edges of a chunk to edge_t, drops duplicates and validates them
+	inline chunk_result decode_chunk(const file_edge_t* file_edges, size_t num_edges, edge_t* edges) {
+		chunk_result result;
+		for (size_t i = 0; i < num_edges; ++i) {
+			const file_edge_t fe = file_edges[i];
+			if (TLX_UNLIKELY(fe.u > MAX_VALID_NODE || fe.v > MAX_VALID_NODE)) {
+				++result.num_invalid;
+				continue;
+			}
+			const edge_t e{static_cast<node_t>(fe.u), static_cast<node_t>(fe.v)};
+			die_unless_valid_edge(e);
+			if (TLX_LIKELY(!result.num_kept || e != edges[result.num_kept - 1])) {
+				result.num_unordered += (result.num_kept && !(edges[result.num_kept - 1] <= e));
+				edges[result.num_kept++] = e;
+			} else {
+				++result.num_parallel;
+			}
+		}
+		return result;
+	}
+}
+
+/**
+ * Reads the header of a graph file. For legacy files without a header, the
+ * returned header has no flags set and only knows the number of edges.
+ */
+inline graph_header_t read_graph_header(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	die_unless(in);
+	const size_t file_bytes = in.tellg();
+	in.seekg(0);
+
+	graph_header_t header;
+	if (file_bytes < sizeof(header) || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header.has_header()) {
+		header = graph_header_t();
+		header.num_edges = file_bytes / sizeof(file_edge_t);
+		return header;
+	}
+	die_unless(header.version == GRAPH_HEADER_VERSION);
+	die_unless(header.data_offset % foxxll::BlockAlignment == 0);
+	die_unless(header.data_offset + header.num_edges * sizeof(file_edge_t) <= file_bytes);
+	return header;
+}
+
+//! Reads the {source, edge position} pairs of a sorted graph file, empty if there is no index
+inline std::vector<file_edge_t> read_graph_source_index(const std::string& filename) {
+	const graph_header_t header = read_graph_header(filename);
+	std::vector<file_edge_t> index;
+	if (!header.has(GRAPH_SOURCE_INDEX))
+		return index;
+	index.resize(header.index_entries);
+	std::ifstream in(filename, std::ios::binary);
+	in.seekg(header.index_offset);
+	die_unless(in.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(file_edge_t)));
+	return index;
+}
+
+/**
+ * Reads a binary edge list into a stream, dropping parallel edges.
+ * Node ids are stored as file_node_t and narrowed to node_t.
+ * An optional graph header is skipped, see read_graph_header.
+ *
+ * The file is split into chunks of chunk_bytes which are read by up to
+ * LOADER_BUFFER_MEM / (2 * chunk_bytes) outstanding asynchronous requests.
+ * num_threads worker threads take the chunks in turn to decode and validate
+ * them while the calling thread pushes them in file order, so duplicates are
+ * dropped across chunk boundaries.
+ */
 template <typename stream_type>
-size_t read_graph_to_stream(std::string input_filename, stream_type& input_stream) {
+size_t read_graph_to_stream(std::string input_filename, stream_type& input_stream,
+                            size_t num_threads = std::thread::hardware_concurrency(),
+                            size_t chunk_bytes = LOADER_CHUNK_SIZE) {
+	using namespace read_graph_details;
+	static_assert(foxxll::BlockAlignment % sizeof(file_edge_t) == 0, "edges must not straddle aligned blocks");
+	assert(chunk_bytes % foxxll::BlockAlignment == 0);
+
+	const graph_header_t header = read_graph_header(input_filename);
 	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector E(input_file);
+	const size_t file_edges = header.num_edges;
+	const size_t chunk_edges = chunk_bytes / sizeof(file_edge_t);
+	const size_t num_chunks = (file_edges + chunk_edges - 1) / chunk_edges;
+	const size_t num_buffers = std::min(num_chunks, std::max<size_t>(2, std::min(2 * std::max<size_t>(num_threads, 1), LOADER_BUFFER_MEM / (2 * chunk_bytes))));
+
+	// O_DIRECT requires aligned lengths, so the unaligned tail is read through the page cache
+	const size_t tail_bytes = (file_edges * sizeof(file_edge_t)) % foxxll::BlockAlignment;
+	foxxll::file_ptr tail_file;
+	if (tail_bytes) {
+		tail_file = tlx::make_counting<foxxll::syscall_file>(input_filename, foxxll::file::RDONLY);
+	}
+
+	struct slot_t {
+		file_edge_t* buffer = nullptr;
+		std::vector<edge_t> edges;
+		size_t num_edges = 0;
+		std::vector<foxxll::request_ptr> requests;
+		size_t issued = 0;  // chunk + 1 once its reads are issued
+		size_t decoded = 0; // chunk + 1 once it is decoded
+		chunk_result result;
+		std::exception_ptr error;
+	};
+	std::vector<slot_t> slots(num_buffers);
+	for (auto& slot : slots) {
+		slot.buffer = static_cast<file_edge_t*>(foxxll::aligned_alloc<foxxll::BlockAlignment>(chunk_bytes));
+		slot.edges.resize(chunk_edges);
+	}
+
+	// slots are handed between the caller and the workers under one lock, there is one hand-off per chunk
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool aborted = false;
+
+	auto issue = [&](size_t chunk) {
+		slot_t& slot = slots[chunk % num_buffers];
+		const size_t first_edge = chunk * chunk_edges;
+		slot.num_edges = std::min(chunk_edges, file_edges - first_edge);
+
+		const size_t offset = header.data_offset + first_edge * sizeof(file_edge_t);
+		const size_t bytes = slot.num_edges * sizeof(file_edge_t);
+		const size_t direct_bytes = (chunk + 1 == num_chunks) ? bytes - tail_bytes : bytes;
+
+		slot.requests.clear();
+		if (direct_bytes) {
+			slot.requests.push_back(input_file->aread(slot.buffer, offset, direct_bytes));
+		}
+		if (direct_bytes != bytes) {
+			slot.requests.push_back(tail_file->aread(reinterpret_cast<char*>(slot.buffer) + direct_bytes, offset + direct_bytes, tail_bytes));
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slot.issued = chunk + 1;
+		}
+		changed.notify_all();
+	};
+
+	// a fixed set of workers takes the chunks in turn, worker w decodes chunks w, w + num_workers, ...
+	const size_t num_workers = std::min(std::max<size_t>(num_threads, 1), num_buffers);
+	auto work = [&](size_t first_chunk) {
+		for (size_t chunk = first_chunk; chunk < num_chunks; chunk += num_workers) {
+			slot_t& slot = slots[chunk % num_buffers];
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return slot.issued == chunk + 1 || aborted; });
+				if (slot.issued != chunk + 1) return;
+			}
+			// issued reads are always waited for, the buffer must not be released while they are in flight
+			try {
+				for (auto& request : slot.requests) {
+					request->wait();
+				}
+				slot.result = decode_chunk(slot.buffer, slot.num_edges, slot.edges.data());
+			} catch (...) {
+				slot.error = std::current_exception();
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.decoded = chunk + 1;
+			}
+			changed.notify_all();
+		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(num_workers);
+	for (size_t w = 0; w < num_workers; ++w) {
+		workers.emplace_back(work, w);
+	}
+
+	for (size_t chunk = 0; chunk < num_buffers; ++chunk) {
+		issue(chunk);
+	}
 
 	size_t num_parallel = 0;
+	size_t num_unordered = 0;
+	size_t num_invalid = 0;
 	size_t num_edges = 0;
 	edge_t prev = edge_t{MIN_NODE, MIN_NODE};
-	for (const auto& e: E) {
-		if (TLX_LIKELY(e != prev)) {
-			input_stream.push(e);
-			prev = e;
-			++num_edges;
-		} else {
+	std::exception_ptr error;
+	for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+		slot_t& slot = slots[chunk % num_buffers];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return slot.decoded == chunk + 1; });
+		}
+		if (slot.error) {
+			error = slot.error;
+			break;
+		}
+		const chunk_result& result = slot.result;
+		num_parallel += result.num_parallel;
+		num_unordered += result.num_unordered;
+		num_invalid += result.num_invalid;
+
+		const edge_t* edges = slot.edges.data();
+		size_t begin = 0;
+		if (result.num_kept && edges[0] == prev) {
 			++num_parallel;
+			begin = 1;
+		} else if (result.num_kept && num_edges) {
+			num_unordered += !(prev <= edges[0]);
+		}
+		for (size_t i = begin; i < result.num_kept; ++i) {
+			input_stream.push(edges[i]);
+		}
+		num_edges += result.num_kept - begin;
+		if (result.num_kept) {
+			prev = edges[result.num_kept - 1];
 		}
+
+		if (chunk + num_buffers < num_chunks) {
+			issue(chunk + num_buffers);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		aborted = true;
+	}
+	changed.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	for (auto& slot : slots) {
+		foxxll::aligned_dealloc<foxxll::BlockAlignment>(slot.buffer);
 	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
 	if (num_parallel > 0) {
 		std::cout << "Dropped " << num_parallel << " parallel edges" << std::endl;
 	}
+	if (num_unordered > 0) {
+		std::cout << "Warning: " << num_unordered << " edges are not sorted by (u, v)" << std::endl;
+	}
+	if (num_invalid > 0) {
+		die("Input graph contains " << num_invalid << " edges with node ids above " << MAX_VALID_NODE);
+	}
 	return num_edges;
 }
 
-void read_graph(std::string fn, em_edge_vector& E) {
-	foxxll::file_ptr input_file = tlx::make_counting<foxxll::syscall_file>(fn, foxxll::file::RDONLY | foxxll::file::DIRECT);
-	const em_edge_vector mapped(input_file);
-	E.resize(mapped.size());
-	em_edge_vector::bufwriter_type bw(E);
-	size_t num_parallel = 0;
-	edge_t prev = edge_t{MIN_NODE, MIN_NODE};
-	for (const auto& e: mapped) {
-		if (TLX_LIKELY(e != prev)) {
-			bw << e;
-			prev = e;
-		} else {
-			++num_parallel;
+inline void read_graph(std::string fn, em_edge_vector& E) {
+	struct vector_pusher {
+		em_edge_vector::bufwriter_type bw;
+		explicit vector_pusher(em_edge_vector& vec) : bw(vec) {}
+		void push(const edge_t& e) { bw << e; }
+	};
+	E.resize(read_graph_header(fn).num_edges);
+	size_t num_edges;
+	{
+		vector_pusher pusher(E);
+		num_edges = read_graph_to_stream(fn, pusher);
+		pusher.bw.finish();
+	}
+	E.resize(num_edges);
+}
+
+/**
+ * Writes a binary edge list (e.g. node/label pairs) without materializing it.
+ *
+ * Edges are widened to file_node_t and collected in block-aligned buffers
+ * which are written by asynchronous direct I/O; a buffer is only reused once
+ * its previous request completed. The unaligned tail is written on close().
+ *
+ * With with_header, the file starts with a graph_header_t whose flags and
+ * max node id are derived from the pushed edges; sorted files additionally
+ * get a sparse source index appended.
+ */
+class GraphWriter {
+public:
+	GraphWriter(const std::string& output_filename,
+	            bool with_header = false,
+	            size_t num_buffers = WRITER_NUM_BUFFERS,
+	            size_t chunk_bytes = WRITER_CHUNK_SIZE)
+		: _filename(output_filename)
+		, _with_header(with_header)
+		, _chunk_edges(chunk_bytes / sizeof(file_edge_t))
+		, _buffers(std::max<size_t>(num_buffers, 1))
+		, _requests(_buffers.size())
+		, _offset(with_header ? GRAPH_HEADER_BYTES : 0)
+	{
+		static_assert(foxxll::BlockAlignment % sizeof(file_edge_t) == 0, "edges must not straddle aligned blocks");
+		static_assert(GRAPH_HEADER_BYTES % foxxll::BlockAlignment == 0, "edges after the header must be aligned");
+		assert(chunk_bytes % foxxll::BlockAlignment == 0);
+
+		foxxll::file::unlink(_filename.c_str());
+		_file = tlx::make_counting<foxxll::syscall_file>(_filename,
+			foxxll::file::WRONLY | foxxll::file::CREAT | foxxll::file::DIRECT);
+		for (auto& buffer : _buffers) {
+			buffer = static_cast<file_edge_t*>(foxxll::aligned_alloc<foxxll::BlockAlignment>(chunk_bytes));
 		}
-		if (num_parallel > 0) {
-			std::cout << "Dropped " << num_parallel << " parallel edges" << std::endl;
+	}
+
+	GraphWriter(const GraphWriter&) = delete;
+	GraphWriter& operator=(const GraphWriter&) = delete;
+
+	~GraphWriter() {
+		close();
+		for (auto buffer : _buffers) {
+			foxxll::aligned_dealloc<foxxll::BlockAlignment>(buffer);
 		}
 	}
-	bw.finish();
-}
 
-void write_graph(const em_edge_vector& E, std::string fn) {
-	std::ofstream out(fn, std::ios::binary);
-	node_t edge[2];
-	// TODO: something smarter
+	void push(node_t u, node_t v) {
+		assert(_file);
+		const edge_t e{u, v};
+		const size_t position = size();
+		if (position) {
+			_sorted &= _prev <= e;
+			_deduplicated &= _prev != e;
+		}
+		_oriented &= u < v;
+		_max_id = std::max({_max_id, u, v});
+		if (_with_header && _sorted && position % GRAPH_INDEX_STRIDE == 0) {
+			_index.push_back(file_edge_t{u, position});
+		}
+		_prev = e;
+
+		_buffers[_current][_fill++] = file_edge_t{u, v};
+		if (TLX_UNLIKELY(_fill == _chunk_edges)) {
+			flush_current();
+		}
+	}
+
+	void push(const edge_t& e) {
+		push(e.u, e.v);
+	}
+
+	GraphWriter& operator<<(const edge_t& e) {
+		push(e);
+		return *this;
+	}
+
+	//! Records the exact number of distinct nodes in the header
+	void set_num_nodes(size_t num_nodes) {
+		_num_nodes = num_nodes;
+	}
+
+	//! Number of edges pushed so far
+	size_t size() const {
+		return _num_edges + _fill;
+	}
+
+	//! Writes the remaining edges and the header and waits for all requests
+	void close() {
+		if (!_file)
+			return;
+
+		const size_t bytes = _fill * sizeof(file_edge_t);
+		const size_t direct_bytes = bytes - bytes % foxxll::BlockAlignment;
+		if (direct_bytes) {
+			_requests[_current] = _file->awrite(_buffers[_current], _offset, direct_bytes);
+		}
+		foxxll::file_ptr tail_file;
+		if (bytes > direct_bytes || _with_header) {
+			tail_file = tlx::make_counting<foxxll::syscall_file>(_filename, foxxll::file::WRONLY);
+		}
+		if (bytes > direct_bytes) {
+			tail_file->awrite(reinterpret_cast<char*>(_buffers[_current]) + direct_bytes,
+			                  _offset + direct_bytes, bytes - direct_bytes)->wait();
+		}
+		_num_edges += _fill;
+		_offset += bytes;
+		_fill = 0;
+
+		for (auto& req : _requests) {
+			if (req) {
+				req->wait();
+				req.reset();
+			}
+		}
+		_file.reset();
+
+		if (_with_header) {
+			write_header(*tail_file);
+		}
+	}
+
+private:
+	std::string _filename;
+	foxxll::file_ptr _file;
+	const bool _with_header;
+	const size_t _chunk_edges;
+	std::vector<file_edge_t*> _buffers;
+	std::vector<foxxll::request_ptr> _requests;
+	size_t _current = 0;
+	size_t _fill = 0;
+	size_t _offset;
+	size_t _num_edges = 0;
+
+	// properties of the pushed edges for the header
+	edge_t _prev = MIN_EDGE;
+	node_t _max_id = MIN_NODE;
+	size_t _num_nodes = 0;
+	bool _sorted = true;
+	bool _oriented = true;
+	bool _deduplicated = true;
+	std::vector<file_edge_t> _index;
+
+	void flush_current() {
+		const size_t bytes = _fill * sizeof(file_edge_t);
+		_requests[_current] = _file->awrite(_buffers[_current], _offset, bytes);
+		_offset += bytes;
+		_num_edges += _fill;
+		_fill = 0;
+
+		_current = (_current + 1) % _buffers.size();
+		if (_requests[_current]) {
+			_requests[_current]->wait();
+			_requests[_current].reset();
+		}
+	}
+
+	void write_header(foxxll::file& file) {
+		graph_header_t header;
+		header.magic = GRAPH_HEADER_MAGIC;
+		header.version = GRAPH_HEADER_VERSION;
+		header.data_offset = GRAPH_HEADER_BYTES;
+		header.num_edges = _num_edges;
+		header.num_nodes = _num_nodes;
+		header.max_node_id = _max_id;
+		if (_num_nodes)
+			header.flags |= GRAPH_NODE_COUNT;
+		if (_sorted)
+			header.flags |= GRAPH_SORTED;
+		if (_oriented)
+			header.flags |= GRAPH_ORIENTED;
+		if (_sorted && _deduplicated)
+			header.flags |= GRAPH_DEDUPLICATED;
+
+		if (_sorted && !_index.empty()) {
+			header.flags |= GRAPH_SOURCE_INDEX;
+			header.index_offset = _offset;
+			header.index_entries = _index.size();
+			file.awrite(_index.data(), _offset, _index.size() * sizeof(file_edge_t))->wait();
+		}
+		// pad to GRAPH_HEADER_BYTES so that an empty graph is still a valid file
+		std::vector<char> block(GRAPH_HEADER_BYTES, 0);
+		std::memcpy(block.data(), &header, sizeof(header));
+		file.awrite(block.data(), 0, block.size())->wait();
+	}
+};
+
+inline void write_graph(const em_edge_vector& E, std::string fn, bool with_header = false, size_t num_nodes = 0) {
+	GraphWriter out(fn, with_header);
+	out.set_num_nodes(num_nodes);
 	for (auto e: E) {
-		edge[0] = e.u;
-		edge[1] = e.v;
-		out.write((char*)(&edge[0]), bytes_per_edge);
+		out.push(e);
 	}
 }
 
-void orient_smaller_to_larger(em_edge_vector& E) {
+inline void orient_smaller_to_larger(em_edge_vector& E) {
 	for (size_t i=0; i<E.size(); i++) {
 		if (E[i].u > E[i].v) {
 			std::swap(E[i].u, E[i].v);
@@ -70,7 +479,7 @@ void orient_smaller_to_larger(em_edge_vector& E) {
 	}
 }
 
-void orient_larger_to_smaller(em_edge_vector& E) {
+inline void orient_larger_to_smaller(em_edge_vector& E) {
 	for (size_t i=0; i<E.size(); i++) {
 		if (E[i].u < E[i].v) {
 			std::swap(E[i].u, E[i].v);
@@ -78,12 +487,12 @@ void orient_larger_to_smaller(em_edge_vector& E) {
 	}
 }
 
-std::ostream& operator<< (std::ostream& out, const edge_t& e) {
+inline std::ostream& operator<< (std::ostream& out, const edge_t& e) {
 	out << e.u << "," << e.v;
 	return out;
 }
 
-std::pair<size_t, node_t> external_number_of_nodes(const em_edge_vector& E) {
+inline std::pair<size_t, node_t> external_number_of_nodes(const em_edge_vector& E) {
 	size_t num_unique = 0;
 	node_t max_node_seen = MIN_NODE;
 	if (E.size() == 0) {
@@ -113,7 +522,7 @@ std::pair<size_t, node_t> external_number_of_nodes(const em_edge_vector& E) {
 	return std::make_pair(num_unique, max_node_seen);
 }
 
-std::pair<size_t, node_t> internal_number_of_nodes(const em_edge_vector& E) {
+inline std::pair<size_t, node_t> internal_number_of_nodes(const em_edge_vector& E) {
 	robin_hood::unordered_set<node_t> node_set;
 	node_t max_node_seen = MIN_NODE;
 	for (const auto& e: E) {
@@ -127,7 +536,7 @@ std::pair<size_t, node_t> internal_number_of_nodes(const em_edge_vector& E) {
 	return std::make_pair(num_unique, max_node_seen);
 }
 
-em_node_vector unique_nodes(const em_edge_vector& E) {
+inline em_node_vector unique_nodes(const em_edge_vector& E) {
 	// actually extract all node IDs and count unique...
 	em_node_vector V;
 	node_t prev_source = MIN_NODE;
@@ -152,6 +561,6 @@ em_node_vector unique_nodes(const em_edge_vector& E) {
 	return V;
 }
 
-auto to_stxxl_rand(std::mt19937_64 &gen) {
+inline auto to_stxxl_rand(std::mt19937_64 &gen) {
 	return [&gen] (auto x) {return std::uniform_int_distribution<decltype(x)>{0, x-1}(gen);};
 }
@@ -1,11 +1,33 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+//! Measurements of one phase of a recursion level, reported to the policy
+struct phase_feedback_t {
+	enum class phase_t { contraction, sampling, relabelling };
+	phase_t phase;
+	unsigned level;
+	size_t nodes_in;       // node upper bound before the phase
+	size_t edges_in;       // edges scanned by the phase
+	size_t nodes_out;      // node upper bound of the result (left sample for sampling)
+	size_t edges_out;
+	int sample_prob_power; // sampling only
+	double elapsed;        // seconds
+	size_t io_bytes;       // read and written
+};
 
 struct policy_t {
 	std::function<bool(size_t n, size_t m, unsigned level, size_t M)> perform_contraction;
 	std::function<size_t(size_t n, size_t m, unsigned level, size_t M)> contract_number;
 	std::function<int(size_t n, size_t m, unsigned level, size_t M)> sample_prob_power;
+	// optional, receives the measured phases
+	std::function<void(const phase_feedback_t& feedback)> observe = nullptr;
+	// optional, number of sample classes the edges are split into in one scan (2 if not set)
+	std::function<unsigned(size_t n, size_t m, unsigned level, size_t M)> sample_classes = nullptr;
 };
 
 inline int nearest_power_reciprocal(size_t n, size_t m) {
@@ -20,7 +42,147 @@ inline size_t threshold_fun_8(size_t n, size_t M) {
 	return std::min(8ul, static_cast<size_t>(2.0*(1.0+(6.0*static_cast<double>(M))/static_cast<double>(n))));
 }
 
-policy_t variant_policies[] =
+/**
+ * Policy that calibrates itself on the phases it observes.
+ *
+ * From the reported phases it keeps running estimates of
+ *  - the cost per edge of contracting and of the non-recursive work of a
+ *    level (sampling and relabelling), where the cost of a phase is its
+ *    elapsed time, but at least its I/O volume at a nominal bandwidth,
+ *  - the edges a contraction retains, as exponent a in
+ *    edges_out / edges_in = (nodes_out / nodes_in)^a,
+ *  - how many nodes a sample covers, as correction to the expected number of
+ *    non-isolated nodes n (1 - exp(-2m/n p)) of a sample with probability p,
+ *  - how much a level shrinks the node bound of its right subproblem.
+ * Sampling takes the largest sample whose nodes are expected to fit into the
+ * base case. Contraction happens if its cost plus the cost of the levels that
+ * remain afterwards is expected to be below the cost of the levels without it;
+ * until both costs were measured, the density rule of variant 6 decides.
+ */
+class AdaptivePolicy {
+public:
+	static constexpr double SMOOTHING = 0.5;
+	static constexpr double NOMINAL_IO_BANDWIDTH = 200e6;
+	static constexpr double MAX_CONTRACT_FRACTION = 0.75;
+	static constexpr int MAX_SAMPLE_PROB_POWER = 16;
+	static constexpr size_t CALIBRATION_DENSITY = 4;
+
+	//! Policy whose functions share one AdaptivePolicy
+	static policy_t make_policy() {
+		auto adaptive = std::make_shared<AdaptivePolicy>();
+		return {
+			[adaptive](size_t n, size_t m, unsigned level, size_t M) {return adaptive->perform_contraction(n, m, level, M);},
+			[adaptive](size_t n, size_t m, unsigned level, size_t M) {return adaptive->contract_number(n, m, level, M);},
+			[adaptive](size_t n, size_t m, unsigned level, size_t M) {return adaptive->sample_prob_power(n, m, level, M);},
+			[adaptive](const phase_feedback_t& feedback) {adaptive->observe(feedback);},
+		};
+	}
+
+	bool perform_contraction(size_t n, size_t m, unsigned, size_t M) const {
+		if (n == 0 || n <= M) return false;
+		if (!contraction_cost.known || !level_cost_known()) {
+			std::cout << "Adaptive policy: calibrating, contract if m/n < " << CALIBRATION_DENSITY << std::endl;
+			return (m/n) < CALIBRATION_DENSITY;
+		}
+
+		const size_t goal = contract_number(n, m, 0, M);
+		const double node_ratio = static_cast<double>(n - goal) / static_cast<double>(n);
+		const double edges_after = static_cast<double>(m) * std::pow(node_ratio, retention_exponent.value);
+		const double cost_with = contraction_cost.value * static_cast<double>(m) + level_cost() * edges_after * remaining_levels(n - goal, M);
+		const double cost_without = level_cost() * static_cast<double>(m) * remaining_levels(n, M);
+		std::cout << "Adaptive policy: expected cost with contraction " << cost_with << ", without " << cost_without << std::endl;
+		return cost_with < cost_without;
+	}
+
+	size_t contract_number(size_t n, size_t, unsigned, size_t M) const {
+		// contract into the base case if it takes not too much, otherwise halve
+		if (M < n && static_cast<double>(n - M) <= MAX_CONTRACT_FRACTION * static_cast<double>(n)) return n - M;
+		return n/2;
+	}
+
+	int sample_prob_power(size_t n, size_t m, unsigned, size_t M) const {
+		if (n == 0) return 1;
+		const double degree = 2.0 * static_cast<double>(m) / static_cast<double>(n);
+		for (int power = 1; power <= MAX_SAMPLE_PROB_POWER; ++power) {
+			if (expected_sample_nodes(n, degree, power) <= static_cast<double>(M)) {
+				std::cout << "Adaptive policy: sample covers about " << expected_sample_nodes(n, degree, power) << " nodes" << std::endl;
+				return power;
+			}
+		}
+		return nearest_power_reciprocal(n, m);
+	}
+
+	void observe(const phase_feedback_t& feedback) {
+		if (feedback.edges_in == 0 || feedback.nodes_in == 0) return;
+		const double cost = std::max(feedback.elapsed, static_cast<double>(feedback.io_bytes) / NOMINAL_IO_BANDWIDTH);
+		const double cost_per_edge = cost / static_cast<double>(feedback.edges_in);
+		const double node_ratio = static_cast<double>(feedback.nodes_out) / static_cast<double>(feedback.nodes_in);
+		const double edge_ratio = static_cast<double>(feedback.edges_out) / static_cast<double>(feedback.edges_in);
+
+		switch (feedback.phase) {
+			case phase_feedback_t::phase_t::contraction:
+				contraction_cost.update(cost_per_edge);
+				if (node_ratio > 0.0 && node_ratio < 1.0 && edge_ratio > 0.0 && edge_ratio <= 1.0) {
+					retention_exponent.update(std::log(edge_ratio) / std::log(node_ratio));
+				}
+				break;
+			case phase_feedback_t::phase_t::sampling: {
+				sampling_cost.update(cost_per_edge);
+				const double degree = 2.0 * static_cast<double>(feedback.edges_in) / static_cast<double>(feedback.nodes_in);
+				const double expected = poisson_sample_nodes(feedback.nodes_in, degree, feedback.sample_prob_power);
+				if (expected > 0.0) sample_correction.update(static_cast<double>(feedback.nodes_out) / expected);
+				break;
+			}
+			case phase_feedback_t::phase_t::relabelling:
+				relabelling_cost.update(cost_per_edge);
+				right_shrink.update(std::min(node_ratio, 1.0));
+				break;
+		}
+	}
+
+private:
+	struct estimate_t {
+		double value;
+		bool known = false;
+
+		void update(double measured) {
+			value = (known ? (1.0 - SMOOTHING) * value + SMOOTHING * measured : measured);
+			known = true;
+		}
+	};
+
+	estimate_t contraction_cost{0.0};
+	estimate_t sampling_cost{0.0};
+	estimate_t relabelling_cost{0.0};
+	estimate_t retention_exponent{1.0};
+	estimate_t sample_correction{1.0};
+	estimate_t right_shrink{0.5};
+
+	bool level_cost_known() const {
+		return sampling_cost.known;
+	}
+
+	double level_cost() const {
+		return sampling_cost.value + relabelling_cost.value;
+	}
+
+	// levels until n nodes fit into the base case
+	double remaining_levels(size_t n, size_t M) const {
+		if (n <= M) return 0.0;
+		const double shrink = std::clamp(right_shrink.value, 0.01, 0.99);
+		return std::ceil(std::log(static_cast<double>(n) / static_cast<double>(std::max<size_t>(M, 1))) / -std::log(shrink));
+	}
+
+	static double poisson_sample_nodes(size_t n, double degree, int power) {
+		return static_cast<double>(n) * (1.0 - std::exp(-degree * std::ldexp(1.0, -power)));
+	}
+
+	double expected_sample_nodes(size_t n, double degree, int power) const {
+		return sample_correction.value * poisson_sample_nodes(n, degree, power);
+	}
+};
+
+inline policy_t variant_policies[] =
 	{
 		{ // 0: default; always contract, contract n/2 and sample with p=1/2 (for KKT in particular)
 			[](size_t, size_t, unsigned, size_t) {return true;},
@@ -86,4 +248,13 @@ policy_t variant_policies[] =
 			},
 			[](size_t n, size_t m, unsigned, size_t) {return nearest_power_reciprocal(n, m);},
 		},
+		// 10: adaptive, calibrated on the measured phases
+		AdaptivePolicy::make_policy(),
+		{ // 11: like 6, but each level splits its edges into 4 sample classes
+			[](size_t n, size_t m, unsigned, size_t) {return (m/n)<4;},
+			[](size_t n, size_t m, unsigned, size_t) {return n-m/4;},
+			[](size_t n, size_t m, unsigned, size_t) {return nearest_power_reciprocal(n, m);},
+			nullptr,
+			[](size_t, size_t, unsigned, size_t) {return 4u;},
+		},
 	};
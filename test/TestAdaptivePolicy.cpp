@@ -0,0 +1,51 @@
+/*
+ * TestAdaptivePolicy.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include "../cpp/variants.hpp"
+
+class TestAdaptivePolicy : public ::testing::Test { };
+
+namespace {
+    using phase = phase_feedback_t::phase_t;
+
+    phase_feedback_t feedback(phase kind, size_t nodes_in, size_t edges_in, size_t nodes_out, size_t edges_out, double elapsed, int power = 0) {
+        return phase_feedback_t{kind, 0, nodes_in, edges_in, nodes_out, edges_out, power, elapsed, 0};
+    }
+}
+
+TEST_F(TestAdaptivePolicy, test_calibration) {
+    AdaptivePolicy policy;
+    // the density rule decides until the phases were measured
+    ASSERT_TRUE(policy.perform_contraction(1000000, 2000000, 0, 1000));
+    ASSERT_FALSE(policy.perform_contraction(1000000, 8000000, 0, 1000));
+    ASSERT_FALSE(policy.perform_contraction(1000, 8000000, 0, 1000));
+
+    // contraction that is cheap and removes most edges pays off
+    policy.observe(feedback(phase::contraction, 1000000, 2000000, 500000, 200000, 1.0));
+    policy.observe(feedback(phase::sampling, 1000000, 2000000, 600000, 1000000, 1.0, 1));
+    policy.observe(feedback(phase::relabelling, 500000, 1000000, 400000, 900000, 1.0));
+    ASSERT_TRUE(policy.perform_contraction(1000000, 8000000, 0, 1000));
+
+    // expensive contraction that keeps the edges does not
+    for (int i = 0; i < 8; ++i) policy.observe(feedback(phase::contraction, 1000000, 2000000, 500000, 2000000, 100.0));
+    ASSERT_FALSE(policy.perform_contraction(1000000, 2000000, 0, 1000));
+}
+
+TEST_F(TestAdaptivePolicy, test_sampling) {
+    AdaptivePolicy policy;
+    // fits without correction: the largest sample
+    ASSERT_EQ(policy.sample_prob_power(1000, 1000, 0, 1000), 1);
+
+    // smaller memory asks for sparser samples
+    const int power = policy.sample_prob_power(1000000, 10000000, 0, 100000);
+    ASSERT_GT(power, 1);
+    ASSERT_GE(policy.sample_prob_power(1000000, 10000000, 0, 10000), power);
+
+    // samples covering more nodes than expected make it sparser
+    for (int i = 0; i < 8; ++i) policy.observe(feedback(phase::sampling, 1000000, 1000000, 1000000, 500000, 1.0, 1));
+    ASSERT_GT(policy.sample_prob_power(1000000, 10000000, 0, 100000), power);
+}
@@ -0,0 +1,55 @@
+/*
+ * TestAsyncSorter.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <stxxl/sorter>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/hungdefs.hpp"
+#include "../cpp/streaming/containers/AsyncSorter.h"
+
+class TestAsyncSorter : public ::testing::Test { };
+
+TEST_F(TestAsyncSorter, test_sorted_output) {
+    using sorter_t = AsyncSorter<stxxl::sorter<edge_t, edge_less_cmp>>;
+    std::mt19937_64 gen(1);
+    std::uniform_int_distribution<node_t> dist(1, 1000000);
+
+    // below and well above the size of a block
+    for (size_t num_edges : {size_t(0), size_t(1000), 5 * sorter_t::BLOCK_ITEMS + 17}) {
+        sorter_t sorter(edge_less_cmp(), SORTER_MEM);
+        std::vector<edge_t> edges;
+        for (size_t i = 0; i < num_edges; ++i) {
+            edges.push_back({dist(gen), dist(gen)});
+            sorter.push(edges.back());
+        }
+        ASSERT_EQ(sorter.size(), num_edges);
+        std::sort(edges.begin(), edges.end(), edge_less_cmp());
+
+        sorter.sort_reuse();
+        for (int round = 0; round < 2; ++round) {
+            ASSERT_EQ(sorter.size(), num_edges);
+            std::vector<edge_t> sorted;
+            for (; !sorter.empty(); ++sorter) sorted.push_back(*sorter);
+            ASSERT_EQ(sorted, edges);
+            sorter.rewind();
+        }
+
+        // abandon the output halfway and reuse the sorter
+        for (size_t i = 0; i < num_edges / 2; ++i) ++sorter;
+        sorter.clear();
+        ASSERT_EQ(sorter.size(), 0);
+        sorter.push({2, 1});
+        sorter.push({1, 2});
+        sorter.sort();
+        ASSERT_EQ(*sorter, (edge_t{1, 2}));
+        ++sorter;
+        ASSERT_EQ(*sorter, (edge_t{2, 1}));
+        ++sorter;
+        ASSERT_TRUE(sorter.empty());
+    }
+}
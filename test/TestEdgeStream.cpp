@@ -0,0 +1,152 @@
+/*
+ * TestEdgeStream.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+
+template <typename T>
+class TestEdgeStream : public ::testing::Test { };
+
+using EdgeStreamTypes = ::testing::Types<EdgeStream, CompressedEdgeStream>;
+TYPED_TEST_SUITE(TestEdgeStream, EdgeStreamTypes);
+
+TYPED_TEST(TestEdgeStream, test_empty) {
+    TypeParam es;
+    es.rewind();
+    ASSERT_TRUE(es.empty());
+    ASSERT_EQ(es.size(), 0u);
+}
+
+TYPED_TEST(TestEdgeStream, test_small) {
+    TypeParam es;
+    es.push(edge_t{1, 2});
+    es.push(edge_t{1, 2});
+    es.push(edge_t{1, 7});
+    es.push(edge_t{3, 2});
+    es.push(edge_t{3, 3});
+    es.push(edge_t{9, 4});
+    es.rewind();
+    ASSERT_EQ(es.size(), 6u);
+    ASSERT_EQ(es.multiedges(), 1u);
+    ASSERT_EQ(es.selfloops(), 1u);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        ASSERT_EQ(*es, edge_t(1, 2)); ++es;
+        ASSERT_EQ(*es, edge_t(1, 2)); ++es;
+        ASSERT_EQ(*es, edge_t(1, 7)); ++es;
+        ASSERT_EQ(*es, edge_t(3, 2)); ++es;
+        ASSERT_EQ(*es, edge_t(3, 3)); ++es;
+        ASSERT_EQ(*es, edge_t(9, 4)); ++es;
+        ASSERT_TRUE(es.empty());
+        es.rewind();
+    }
+}
+
+TYPED_TEST(TestEdgeStream, test_random_sorted) {
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<node_t> dist(1, node_t{1} << 40);
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < 100000; ++i) {
+        edges.emplace_back(dist(gen) >> (i % 37), dist(gen) >> (i % 41));
+    }
+    std::sort(edges.begin(), edges.end(), edge_lt_ordering());
+
+    TypeParam es;
+    for (const auto & e : edges) es.push(e);
+    es.rewind();
+
+    for (const auto & e : edges) {
+        ASSERT_FALSE(es.empty());
+        ASSERT_EQ(*es, e);
+        ++es;
+    }
+    ASSERT_TRUE(es.empty());
+}
+
+TYPED_TEST(TestEdgeStream, test_forward_sources_below) {
+    std::mt19937_64 gen(7);
+    std::uniform_int_distribution<node_t> dist(1, 5000);
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < 20000; ++i) {
+        edges.emplace_back(dist(gen), dist(gen));
+    }
+    std::sort(edges.begin(), edges.end(), edge_lt_ordering());
+
+    TypeParam es;
+    for (const auto & e : edges) es.push(e);
+    es.rewind();
+
+    std::vector<edge_t> forwarded;
+    struct {
+        std::vector<edge_t>& out;
+        void push(const edge_t& e) { out.push_back(e); }
+    } pusher{forwarded};
+
+    auto it = edges.cbegin();
+    for (node_t bound = 1; bound <= 5001; bound += 1 + gen() % 300) {
+        forwarded.clear();
+        const size_t num_sources = es.forward_sources_below(bound, pusher);
+
+        std::vector<edge_t> expected;
+        size_t expected_sources = 0;
+        for (; it != edges.cend() && it->u < bound; ++it) {
+            expected_sources += (expected.empty() || expected.back().u != it->u);
+            expected.push_back(*it);
+        }
+        ASSERT_EQ(forwarded, expected);
+        ASSERT_EQ(num_sources, expected_sources);
+        if (it == edges.cend()) {
+            ASSERT_TRUE(es.empty());
+        } else {
+            ASSERT_EQ(*es, *it);
+        }
+    }
+}
+
+TYPED_TEST(TestEdgeStream, test_pool_lease) {
+    auto & pool = EdgeStreamPool::instance();
+    const size_t leased_before = pool.leased();
+
+    TypeParam es;
+    es.push(edge_t{1, 2});
+    es.push(edge_t{2, 3});
+    ASSERT_EQ(pool.leased(), leased_before);
+
+    // prefetch depth is only held while reading
+    es.rewind();
+    ASSERT_GT(pool.leased(), leased_before);
+    ++es;
+    ASSERT_FALSE(es.empty());
+    ++es;
+    ASSERT_TRUE(es.empty());
+    ASSERT_EQ(pool.leased(), leased_before);
+
+    es.rewind();
+    ASSERT_GT(pool.leased(), leased_before);
+    es.clear();
+    ASSERT_EQ(pool.leased(), leased_before);
+}
+
+TEST(TestEdgeStreamPool, test_lease_exhausted) {
+    auto & pool = EdgeStreamPool::instance();
+    const size_t leased_before = pool.leased();
+
+    // leases halve what is left and run dry instead of overcommitting the pool
+    std::vector<size_t> granted;
+    do {
+        granted.push_back(pool.lease(4));
+    } while (granted.back());
+    ASSERT_LE(pool.leased() - leased_before, pool.budget() / EdgeStreamPool::kBlockBytes);
+    ASSERT_EQ(pool.lease(1), 0u);
+
+    for (size_t blocks : granted) {
+        pool.release(blocks);
+    }
+    ASSERT_EQ(pool.leased(), leased_before);
+}
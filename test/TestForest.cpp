@@ -0,0 +1,147 @@
+/*
+ * TestForest.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <set>
+#include <stxxl/sorter>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+#include "../cpp/streaming/contraction/KKTContraction.h"
+#include "../cpp/streaming/contraction/Sibeyn.hpp"
+#include "../cpp/streaming/contraction/StarContraction.h"
+#include "../cpp/streaming/FunctionalSubproblemManager.h"
+#include "TestGraphs.h"
+
+namespace {
+    struct VectorEdges {
+        using value_type = edge_t;
+        std::vector<edge_t> edges;
+
+        void push(const edge_t& edge) { edges.push_back(edge); }
+    };
+
+    // the forest consists of input edges, has no cycle and spans every component
+    void expect_spanning_forest(const std::vector<edge_t>& edges, const std::vector<edge_t>& forest) {
+        std::set<edge_t, edge_less_cmp> input;
+        UnionFind graph;
+        size_t num_merges = 0;
+        for (const auto& edge : edges) {
+            input.insert(edge.normalized());
+            num_merges += graph.unite(edge.u, edge.v);
+        }
+
+        UnionFind spanned;
+        for (const auto& edge : forest) {
+            ASSERT_EQ(edge, edge.normalized());
+            ASSERT_TRUE(input.count(edge)) << edge;
+            ASSERT_TRUE(spanned.unite(edge.u, edge.v)) << edge;
+        }
+        ASSERT_EQ(forest.size(), num_merges);
+    }
+
+    policy_t always_contract_policy{
+        [](size_t, size_t, unsigned, size_t) { return true; },
+        [](size_t n, size_t, unsigned, size_t) { return n / 2; },
+        [](size_t, size_t, unsigned, size_t) { return 1; },
+    };
+
+    template <typename Contraction>
+    std::vector<edge_t> fsm_forest(const std::vector<edge_t>& edges, node_t num_nodes, size_t memory, policy_t policy = always_contract_policy) {
+        EdgeStream stream;
+        for (const auto& edge : edges) stream.push(edge);
+        stream.consume();
+
+        FunctionalSubproblemManager<EdgeStream, Contraction> funman(stream, memory, num_nodes, policy, 1, true);
+        std::vector<edge_t> forest;
+        for (auto& out = funman.forest(); !out.empty(); ++out) forest.push_back(*out);
+        return forest;
+    }
+}
+
+class TestForest : public ::testing::Test { };
+
+TEST_F(TestForest, test_kruskal) {
+    const auto edges = random_graph(30000, 40000, 1);
+
+    PipelinedKruskal sequential;
+    sequential.keep_forest();
+    for (const auto& edge : edges) sequential.push(edge);
+    VectorEdges sequential_forest;
+    sequential.process_forest(sequential_forest);
+    expect_spanning_forest(edges, sequential_forest.edges);
+
+    ParallelKruskal parallel(4);
+    parallel.keep_forest();
+    for (const auto& edge : edges) parallel.push(edge);
+    VectorEdges parallel_forest;
+    parallel.process_forest(parallel_forest);
+    expect_spanning_forest(edges, parallel_forest.edges);
+}
+
+TEST_F(TestForest, test_sibeyn) {
+    const auto edges = random_graph(20000, 10000, 2);
+    for (size_t contract_num : {1000, 5000, 10000}) {
+        EdgeStream input, input_forest;
+        for (const auto& edge : edges) {
+            input.push(edge);
+            input_forest.push(edge);
+        }
+        input.consume();
+        input_forest.consume();
+
+        VectorEdges tree, contracted, tree_forest, contracted_forest, forest;
+        run_sibeyn_tuned(input, contract_num, tree, contracted);
+        run_sibeyn_tuned<edge_loaded_edge_t>(input_forest, contract_num, tree_forest, contracted_forest, forest);
+        ASSERT_EQ(tree.edges, tree_forest.edges);
+        ASSERT_EQ(contracted.edges.size(), contracted_forest.edges.size());
+        ASSERT_EQ(forest.edges.size(), tree.edges.size());
+
+        // the forest spans the same groups as the tree edges
+        UnionFind groups;
+        for (const auto& edge : tree.edges) groups.unite(edge.u, edge.v);
+        UnionFind spanned;
+        std::set<edge_t, edge_less_cmp> input_set(edges.begin(), edges.end());
+        for (const auto& edge : forest.edges) {
+            ASSERT_TRUE(input_set.count(edge)) << edge;
+            ASSERT_TRUE(spanned.unite(edge.u, edge.v)) << edge;
+        }
+        for (const auto& edge : tree.edges) {
+            ASSERT_EQ(spanned.find(edge.u), spanned.find(edge.v));
+        }
+    }
+}
+
+TEST_F(TestForest, test_lifter) {
+    // groups {1, 2, 3} -> 1 and {4, 5} -> 4
+    stxxl::sorter<node_component_t, node_component_node_cc_less_cmp> map(node_component_node_cc_less_cmp(), SORTER_MEM);
+    for (const auto& entry : std::vector<node_component_t>{{1, 1}, {2, 1}, {3, 1}, {4, 4}, {5, 4}}) map.push(entry);
+    map.sort_reuse();
+
+    EdgeStream edges;
+    for (const auto& edge : std::vector<edge_t>{{1, 2}, {2, 3}, {3, 5}, {5, 6}, {6, 7}}) edges.push(edge);
+    edges.consume();
+
+    stxxl::sorter<edge_t, edge_less_cmp> forest(edge_less_cmp(), SORTER_MEM);
+    forest.push(edge_t{1, 4});
+    forest.push(edge_t{4, 6});
+    forest.sort();
+
+    VectorEdges lifted;
+    ForestLifter(map, edges, forest, lifted);
+    ASSERT_EQ(lifted.edges, std::vector<edge_t>({{3, 5}, {5, 6}}));
+}
+
+TEST_F(TestForest, test_functional) {
+    const node_t num_nodes = 20000;
+    const auto edges = random_graph(30000, num_nodes, 3);
+    // small enough to recurse a few levels
+    const size_t memory = num_nodes / 8 * sizeof(node_t) * (BaseKruskal::MEMORY_OVERHEAD_FACTOR + 3);
+
+    expect_spanning_forest(edges, fsm_forest<SibeynContraction>(edges, num_nodes, memory));
+    expect_spanning_forest(edges, fsm_forest<StarContraction>(edges, num_nodes, memory));
+    expect_spanning_forest(edges, fsm_forest<KKTContraction>(edges, num_nodes, memory));
+    expect_spanning_forest(edges, fsm_forest<SibeynContraction>(edges, num_nodes, memory, AdaptivePolicy::make_policy()));
+}
@@ -0,0 +1,122 @@
+/*
+ * TestFusedEdgeRelabeller.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stxxl/sorter>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/hungdefs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+#include "../cpp/streaming/relabelling/FusedEdgeRelabeller.h"
+
+class TestFusedEdgeRelabeller : public ::testing::Test { };
+
+TEST_F(TestFusedEdgeRelabeller, test_relabel) {
+    using map_sorter_t = stxxl::sorter<node_component_t, node_component_node_cc_less_cmp>;
+    using out_map_sorter_t = stxxl::sorter<node_component_t, node_component_cc_node_less_cmp>;
+    using edge_sorter_t = stxxl::sorter<edge_t, edge_less_cmp>;
+
+    std::mt19937_64 gen(1);
+    std::uniform_int_distribution<node_t> dist(1, 20000);
+
+    // every other node is mapped into a group labelled by its smallest node
+    std::map<node_t, node_t> labels;
+    for (node_t u = 2; u <= 20000; u += 2) labels[u] = std::max<node_t>(2, u - u % 16);
+
+    // edges sorted by source, some with their target before the source
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < 50000; ++i) {
+        const edge_t edge{dist(gen), dist(gen)};
+        if (edge.u == edge.v) continue;
+        edges.push_back(i % 10 ? edge.normalized() : edge);
+    }
+    std::sort(edges.begin(), edges.end(), edge_less_cmp());
+
+    std::vector<edge_t> expected;
+    for (const auto& edge : edges) {
+        const node_t u = (labels.count(edge.u) ? labels[edge.u] : edge.u);
+        const node_t v = (labels.count(edge.v) ? labels[edge.v] : edge.v);
+        if (u != v) expected.push_back(edge_t{u, v}.normalized());
+    }
+    std::sort(expected.begin(), expected.end(), edge_less_cmp());
+
+    // with and without room for the map
+    for (size_t semi_external_mem : {size_t(0), size_t(1) << 30}) {
+        map_sorter_t map(node_component_node_cc_less_cmp(), SORTER_MEM);
+        for (const auto& [node, label] : labels) map.push(node_component_t{node, label});
+        map.sort();
+
+        EdgeStream stream;
+        for (const auto& edge : edges) stream.push(edge);
+        stream.consume();
+
+        out_map_sorter_t out_map(node_component_cc_node_less_cmp(), SORTER_MEM);
+        edge_sorter_t relabelled(edge_less_cmp(), SORTER_MEM);
+        FusedEdgeRelabeller relabeller(map, out_map, stream, relabelled, semi_external_mem);
+        ASSERT_EQ(relabeller.semi_external(), semi_external_mem > 0);
+        ASSERT_EQ(out_map.size(), labels.size());
+        ASSERT_TRUE(map.empty());
+
+        relabelled.sort();
+        std::vector<edge_t> actual;
+        for (; !relabelled.empty(); ++relabelled) actual.push_back(*relabelled);
+        ASSERT_EQ(actual, expected);
+
+        // bounds the distinct nodes
+        std::vector<node_t> nodes;
+        for (const auto& edge : actual) {
+            nodes.push_back(edge.u);
+            nodes.push_back(edge.v);
+        }
+        std::sort(nodes.begin(), nodes.end());
+        ASSERT_GE(relabeller.node_upp_bnd(), std::unique(nodes.begin(), nodes.end()) - nodes.begin());
+    }
+}
+
+TEST_F(TestFusedEdgeRelabeller, test_node_upp_bnd) {
+    using map_sorter_t = stxxl::sorter<node_component_t, node_component_node_cc_less_cmp>;
+    using out_map_sorter_t = stxxl::sorter<node_component_t, node_component_cc_node_less_cmp>;
+    using edge_sorter_t = stxxl::sorter<edge_t, edge_less_cmp>;
+
+    std::mt19937_64 gen(2);
+    std::uniform_int_distribution<node_t> dist(1, 5000);
+
+    // few nodes with many edges each, every third node is mapped
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < 50000; ++i) {
+        const edge_t edge{dist(gen), dist(gen)};
+        if (edge.u == edge.v) continue;
+        edges.push_back(edge.normalized());
+    }
+    std::sort(edges.begin(), edges.end(), edge_less_cmp());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<node_t> nodes;
+    for (const auto& edge : edges) {
+        nodes.push_back(edge.u);
+        nodes.push_back(edge.v);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    const auto num_nodes = static_cast<node_t>(std::unique(nodes.begin(), nodes.end()) - nodes.begin());
+
+    map_sorter_t map(node_component_node_cc_less_cmp(), SORTER_MEM);
+    for (node_t u = 3; u <= 5000; u += 3) map.push(node_component_t{u, 3});
+    map.sort();
+
+    EdgeStream stream;
+    for (const auto& edge : edges) stream.push(edge);
+    stream.consume();
+
+    out_map_sorter_t out_map(node_component_cc_node_less_cmp(), SORTER_MEM);
+    edge_sorter_t relabelled(edge_less_cmp(), SORTER_MEM);
+    FusedEdgeRelabeller relabeller(map, out_map, stream, relabelled, size_t(1) << 30);
+    ASSERT_TRUE(relabeller.semi_external());
+
+    // the lookup counts every node of the input once
+    ASSERT_EQ(relabeller.node_upp_bnd(), num_nodes);
+}
@@ -0,0 +1,84 @@
+/*
+ * TestGraphs.h
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+#include "../cpp/defs.hpp"
+
+// sorted, unique and normalized edges without self-loops
+inline std::vector<edge_t> random_graph(size_t num_edges, node_t num_nodes, unsigned seed) {
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<node_t> dist(1, num_nodes);
+    std::set<edge_t, edge_less_cmp> edges;
+    while (edges.size() < num_edges) {
+        const edge_t edge = edge_t{dist(gen), dist(gen)}.normalized();
+        if (edge.u != edge.v) edges.insert(edge);
+    }
+    return std::vector<edge_t>(edges.begin(), edges.end());
+}
+
+// unsorted edges between ids in [min_id, min_id + range), possibly parallel or self-loops
+inline std::vector<edge_t> random_edges(size_t num_edges, node_t min_id, node_t range, unsigned seed) {
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<node_t> dist(min_id, min_id + range - 1);
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < num_edges; ++i) {
+        edges.emplace_back(dist(gen), dist(gen));
+    }
+    return edges;
+}
+
+// reference union-find over arbitrary ids; the root of a component is its smallest node
+class UnionFind {
+public:
+    node_t find(node_t u) {
+        auto it = parent.emplace(u, u).first;
+        if (it->second == u) return u;
+        return it->second = find(it->second);
+    }
+
+    bool unite(node_t u, node_t v) {
+        u = find(u);
+        v = find(v);
+        if (u == v) return false;
+        parent[std::max(u, v)] = std::min(u, v);
+        return true;
+    }
+
+    // smallest node of the component per node seen so far
+    std::map<node_t, node_t> components() {
+        std::map<node_t, node_t> result;
+        for (const auto& [node, _] : parent) result[node] = find(node);
+        return result;
+    }
+
+private:
+    std::map<node_t, node_t> parent;
+};
+
+// maps every node of the edges to the smallest node of its component
+inline std::map<node_t, node_t> reference_components(const std::vector<edge_t>& edges) {
+    UnionFind uf;
+    for (const auto& edge : edges) uf.unite(edge.u, edge.v);
+    return uf.components();
+}
+
+// maps every node of a component map to the smallest node with the same label
+inline std::map<node_t, node_t> canonical_components(const std::vector<node_component_t>& entries) {
+    std::map<node_t, node_t> min_of_label;
+    for (const auto& entry : entries) {
+        auto it = min_of_label.emplace(entry.load, entry.node).first;
+        it->second = std::min(it->second, entry.node);
+    }
+    std::map<node_t, node_t> result;
+    for (const auto& entry : entries) result[entry.node] = min_of_label[entry.load];
+    return result;
+}
@@ -0,0 +1,41 @@
+/*
+ * TestHyperLogLog.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <random>
+#include "../cpp/streaming/distinct_elements/HyperLogLog.h"
+
+class TestHyperLogLog : public ::testing::Test { };
+
+TEST_F(TestHyperLogLog, test_estimate) {
+    std::mt19937_64 gen(1);
+    const unsigned precision = HyperLogLog::precision_for(0.02);
+    ASSERT_LE(1.04 / std::sqrt(static_cast<double>(size_t(1) << precision)), 0.02);
+
+    for (uint64_t num_distinct : {10, 1000, 200000}) {
+        HyperLogLog sketch(gen, precision);
+        // consecutive ids, each seen a few times
+        for (int round = 0; round < 3; ++round) {
+            for (uint64_t x = 1; x <= num_distinct; ++x) sketch(x);
+        }
+        ASSERT_NEAR(sketch.estimate(), num_distinct, 3 * sketch.standard_error() * num_distinct + 1) << num_distinct;
+    }
+}
+
+TEST_F(TestHyperLogLog, test_merge) {
+    // merging requires the same seed
+    std::mt19937_64 gen_left(2), gen_right(2);
+    HyperLogLog left(gen_left, 12);
+    HyperLogLog right(gen_right, 12);
+
+    // overlapping ranges
+    for (uint64_t x = 0; x < 200000; ++x) left(x);
+    for (uint64_t x = 100000; x < 300000; ++x) right(x);
+
+    HyperLogLog both(left);
+    both.merge(right);
+    ASSERT_NEAR(both.estimate(), 300000, 3 * both.standard_error() * 300000);
+}
@@ -0,0 +1,171 @@
+/*
+ * TestKruskal.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <set>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/basecase/ParallelKruskal.h"
+#include "../cpp/streaming/basecase/StreamKruskal.h"
+#include "../cpp/streaming/basecase/PipelinedKruskal.h"
+#include "TestGraphs.h"
+
+namespace {
+    struct VectorEdgeStream {
+        using value_type = edge_t;
+        const std::vector<edge_t>& edges;
+        size_t pos = 0;
+
+        bool empty() const { return pos >= edges.size(); }
+        const edge_t& operator*() const { return edges[pos]; }
+        VectorEdgeStream& operator++() { ++pos; return *this; }
+    };
+
+    struct VectorComponents {
+        using value_type = node_component_t;
+        std::vector<node_component_t> entries;
+
+        void push(const node_component_t& entry) { entries.push_back(entry); }
+    };
+}
+
+class TestKruskal : public ::testing::Test { };
+
+TEST_F(TestKruskal, test_dense_ids) {
+    const auto edges = random_edges(20000, 1000, 30000, 1);
+    StreamKruskal kruskal;
+    VectorComponents ccs;
+    VectorEdgeStream stream{edges};
+    kruskal.process(ccs, stream);
+
+    ASSERT_TRUE(kruskal.uses_direct_addressing());
+    ASSERT_EQ(canonical_components(ccs.entries), reference_components(edges));
+}
+
+TEST_F(TestKruskal, test_sparse_ids) {
+    auto edges = random_edges(5000, 1, 4000, 2);
+    for (auto& e : edges) e.v = e.v * 1000003;
+    StreamKruskal kruskal;
+    VectorComponents ccs;
+    VectorEdgeStream stream{edges};
+    kruskal.process(ccs, stream);
+
+    ASSERT_FALSE(kruskal.uses_direct_addressing());
+    ASSERT_EQ(canonical_components(ccs.entries), reference_components(edges));
+}
+
+TEST_F(TestKruskal, test_growing_range) {
+    // dense ids first, then ids below and above the initial range, then a far outlier
+    auto edges = random_edges(10000, 50000, 10000, 3);
+    for (const auto& e : random_edges(40000, 1, 50000, 4)) edges.push_back(e);
+    for (const auto& e : random_edges(40000, 60000, 40000, 5)) edges.push_back(e);
+
+    PipelinedKruskal kruskal;
+    for (const auto& e : edges) kruskal.push(e);
+    kruskal.flush();
+    ASSERT_TRUE(kruskal.uses_direct_addressing());
+
+    edges.emplace_back(7, node_t{1} << 40);
+    kruskal.push(edges.back());
+    kruskal.flush();
+    ASSERT_FALSE(kruskal.uses_direct_addressing());
+
+    VectorComponents ccs;
+    kruskal.process(ccs);
+    ASSERT_EQ(canonical_components(ccs.entries), reference_components(edges));
+}
+
+TEST_F(TestKruskal, test_given_range) {
+    const auto edges = random_edges(100, 500, 100, 6);
+    PipelinedKruskal kruskal;
+    kruskal.set_id_range(500, 599);
+    ASSERT_TRUE(kruskal.uses_direct_addressing());
+    for (const auto& e : edges) kruskal.push(e);
+
+    VectorComponents ccs;
+    kruskal.process(ccs);
+    ASSERT_EQ(canonical_components(ccs.entries), reference_components(edges));
+}
+
+TEST_F(TestKruskal, test_sorted_sources) {
+    // runs of one source span batch boundaries; the last run continues after a flush
+    auto edges = random_edges(5000, 1, 1000000, 11);
+    for (auto& e : edges) e.u = e.u % 7 + 1;
+    std::sort(edges.begin(), edges.end(), [](const edge_t& a, const edge_t& b) { return a.u < b.u || (a.u == b.u && a.v < b.v); });
+
+    PipelinedKruskal kruskal;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        kruskal.push(edges[i]);
+        if (i == edges.size() / 2) kruskal.flush();
+    }
+    VectorComponents ccs;
+    kruskal.process(ccs);
+    const auto expected = reference_components(edges);
+    ASSERT_EQ(canonical_components(ccs.entries), expected);
+    ASSERT_EQ(kruskal.get_num_nodes(), expected.size());
+}
+
+TEST_F(TestKruskal, test_memory_overhead) {
+    // sparse ids use the hash table, dense ids the direct-addressed map; both without, with a too small and with a fitting estimate
+    auto sparse = random_edges(200000, 1, 200000, 9);
+    for (auto& e : sparse) e.v = e.v * 1000003;
+    auto dense = random_edges(200000, 1, 200000, 10);
+
+    for (const auto* edges : {&sparse, &dense}) {
+        for (node_t estimate : {node_t{0}, node_t{1000}, node_t{400000}}) {
+            PipelinedKruskal kruskal;
+            kruskal.reserve(estimate);
+            for (const auto& e : *edges) kruskal.push(e);
+            kruskal.flush();
+            ASSERT_EQ(kruskal.uses_direct_addressing(), edges == &dense);
+
+            const size_t bound = std::max<size_t>(kruskal.get_num_nodes(), estimate) * sizeof(node_t) * PipelinedKruskal::MEMORY_OVERHEAD_FACTOR;
+            ASSERT_LE(kruskal.memory_bytes(), bound);
+        }
+    }
+}
+
+TEST_F(TestKruskal, test_parallel) {
+    // enough edges for several blocks, plus a long path whose unions race between workers
+    auto edges = random_edges(3 * ParallelKruskal::BLOCK_EDGES, 1, 400000, 7);
+    for (node_t u = 500000; u < 700000; ++u) edges.emplace_back(u, u + 1);
+
+    // the estimate is either absent, too small or enough for all nodes
+    for (const auto [num_threads, estimate] : std::vector<std::pair<size_t, node_t>>{{1, 0}, {4, 0}, {4, 100000}, {4, 800000}}) {
+        ParallelKruskal kruskal(num_threads, estimate);
+        VectorComponents ccs;
+        VectorEdgeStream stream{edges};
+        kruskal.process(ccs, stream);
+
+        const auto expected = reference_components(edges);
+        ASSERT_EQ(canonical_components(ccs.entries), expected);
+
+        std::set<node_t> roots;
+        for (const auto& [u, root] : expected) roots.insert(root);
+        ASSERT_EQ(kruskal.get_num_ccs(), roots.size());
+    }
+
+    // until finished, the parents and their segment tables fit the overhead factor and the edge blocks the queue memory
+    ASSERT_LE(ParallelKruskal::buffer_bytes(4), ParallelKruskal::QUEUE_MEM);
+    for (node_t estimate : {node_t{0}, node_t{100000}, node_t{800000}}) {
+        ParallelKruskal kruskal(4, estimate);
+        for (const auto& e : edges) kruskal.push(e);
+        const size_t bound = std::max<size_t>(kruskal.get_num_nodes(), estimate) * sizeof(node_t) * ParallelKruskal::MEMORY_OVERHEAD_FACTOR;
+        ASSERT_LE(kruskal.memory_bytes(), bound + ParallelKruskal::buffer_bytes(4));
+        kruskal.finish();
+        ASSERT_LE(kruskal.memory_bytes(), bound);
+    }
+
+    // few edges are merged without starting threads
+    const auto small = random_edges(100, 1, 200, 8);
+    ParallelKruskal kruskal;
+    for (const auto& e : small) kruskal.push(e);
+    VectorComponents ccs;
+    kruskal.process(ccs);
+    ASSERT_EQ(canonical_components(ccs.entries), reference_components(small));
+}
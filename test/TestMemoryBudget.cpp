@@ -0,0 +1,89 @@
+/*
+ * TestMemoryBudget.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+#include "../cpp/streaming/contraction/StarContraction.h"
+#include "../cpp/streaming/FunctionalSubproblemManager.h"
+#include "../cpp/streaming/utils/MemoryBudget.h"
+#include "../cpp/streaming/utils/PhaseTelemetry.h"
+#include "TestGraphs.h"
+
+class TestMemoryBudget : public ::testing::Test { };
+
+TEST_F(TestMemoryBudget, test_level_data_sorter_mem) {
+    auto & budget = MemoryBudget::instance();
+    budget.set_budget(size_t(16) * UIntScale::Gi);
+
+    // halves with every level down to the floor, the first level gets what a level sorter gets
+    ASSERT_EQ(budget.level_data_sorter_mem(0), budget.level_sorter_mem());
+    ASSERT_EQ(budget.level_data_sorter_mem(1), budget.level_sorter_mem() / 2);
+    ASSERT_EQ(budget.level_data_sorter_mem(20), MemoryBudget::MIN_SORTER_MEM);
+    ASSERT_EQ(budget.level_data_sorter_mem(100), MemoryBudget::MIN_SORTER_MEM);
+
+    budget.clear_budget();
+    ASSERT_FALSE(budget.configured());
+    ASSERT_EQ(budget.level_data_sorter_mem(3), SORTER_MEM);
+}
+
+TEST_F(TestMemoryBudget, test_deep_recursion) {
+    const node_t num_nodes = 20000;
+    const auto edges = random_graph(30000, num_nodes, 6);
+    const auto expected = reference_components(edges);
+    // contracting half of the nodes per level takes several levels to reach the base case
+    const size_t memory = num_nodes / 64 * sizeof(node_t) * BaseKruskal::MEMORY_OVERHEAD_FACTOR;
+    policy_t policy{
+        [](size_t, size_t, unsigned, size_t) { return true; },
+        [](size_t n, size_t, unsigned, size_t) { return n / 2; },
+        [](size_t, size_t, unsigned, size_t) { return 1; },
+    };
+
+    auto & budget = MemoryBudget::instance();
+    budget.set_budget(size_t(8) * UIntScale::Gi);
+
+    const std::string path = "memory_budget_levels.csv";
+    ASSERT_TRUE(PhaseTelemetry::instance().open(path));
+    {
+        EdgeStream stream;
+        for (const auto& edge : edges) stream.push(edge);
+        stream.consume();
+
+        FunctionalSubproblemManager<EdgeStream, StarContraction> funman(stream, memory, num_nodes, policy, 1);
+
+        // the labels partition the nodes like the expected components
+        std::map<node_t, node_t> label_to_component;
+        size_t num_labelled = 0;
+        for (; !funman.empty(); ++funman) {
+            const auto node_cc = *funman;
+            ASSERT_TRUE(expected.count(node_cc.node)) << node_cc.node;
+            const auto component = expected.at(node_cc.node);
+            ASSERT_EQ(label_to_component.emplace(node_cc.load, component).first->second, component);
+            ++num_labelled;
+        }
+        ASSERT_EQ(num_labelled, expected.size());
+    }
+    PhaseTelemetry::instance().close();
+
+    std::ifstream in(path);
+    unsigned max_level = 0;
+    std::string line;
+    std::getline(in, line);
+    for (; std::getline(in, line);) max_level = std::max(max_level, static_cast<unsigned>(std::stoul(line)));
+    in.close();
+    std::remove(path.c_str());
+    ASSERT_GE(max_level, 3u);
+
+    // every reservation is given back
+    ASSERT_EQ(budget.reserved(), 0u);
+    budget.clear_budget();
+}
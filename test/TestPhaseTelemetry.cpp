@@ -0,0 +1,84 @@
+/*
+ * TestPhaseTelemetry.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+#include "../cpp/streaming/contraction/StarContraction.h"
+#include "../cpp/streaming/FunctionalSubproblemManager.h"
+#include "../cpp/streaming/utils/PhaseTelemetry.h"
+#include "TestGraphs.h"
+
+class TestPhaseTelemetry : public ::testing::Test { };
+
+namespace {
+    std::vector<std::string> read_lines(const std::string& path) {
+        std::ifstream in(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(in, line);) lines.push_back(line);
+        return lines;
+    }
+}
+
+TEST_F(TestPhaseTelemetry, test_formats) {
+    const phase_record_t record{2, false, "relabelling", "time_forward", 100, 400, 60, 350, 0, 0.5, 0.25, 4096, 8192};
+    auto & telemetry = PhaseTelemetry::instance();
+
+    const std::string csv_path = "phase_telemetry_test.csv";
+    ASSERT_TRUE(telemetry.open(csv_path));
+    telemetry.record(record);
+    telemetry.close();
+    ASSERT_EQ(read_lines(csv_path), std::vector<std::string>({
+        "level,side,phase,branch,nodes_in,edges_in,nodes_out,edges_out,nodes_actual,elapsed,io_wait,read_bytes,written_bytes",
+        "2,right,relabelling,time_forward,100,400,60,350,0,0.5,0.25,4096,8192"}));
+    std::remove(csv_path.c_str());
+
+    const std::string json_path = "phase_telemetry_test.jsonl";
+    ASSERT_TRUE(telemetry.open(json_path));
+    telemetry.record(record);
+    telemetry.close();
+    ASSERT_EQ(read_lines(json_path), std::vector<std::string>({
+        "{\"level\":2,\"side\":\"right\",\"phase\":\"relabelling\",\"branch\":\"time_forward\",\"nodes_in\":100,\"edges_in\":400,"
+        "\"nodes_out\":60,\"edges_out\":350,\"nodes_actual\":0,\"elapsed\":0.5,\"io_wait\":0.25,\"read_bytes\":4096,\"written_bytes\":8192}"}));
+    std::remove(json_path.c_str());
+
+    // closed, records are dropped
+    ASSERT_FALSE(telemetry.enabled());
+    telemetry.record(record);
+}
+
+TEST_F(TestPhaseTelemetry, test_functional) {
+    const node_t num_nodes = 20000;
+    EdgeStream stream;
+    for (const auto& edge : random_graph(30000, num_nodes, 5)) stream.push(edge);
+    stream.consume();
+
+    const std::string path = "phase_telemetry_fsm.csv";
+    ASSERT_TRUE(PhaseTelemetry::instance().open(path));
+    {
+        policy_t policy = variant_policies[0];
+        const size_t memory = num_nodes / 8 * sizeof(node_t) * BaseKruskal::MEMORY_OVERHEAD_FACTOR;
+        FunctionalSubproblemManager<EdgeStream, StarContraction> funman(stream, memory, num_nodes, policy, 1);
+    }
+    PhaseTelemetry::instance().close();
+
+    // every recursion level records its phases, the whole run comes last
+    const auto lines = read_lines(path);
+    std::remove(path.c_str());
+    ASSERT_GT(lines.size(), 2u);
+    auto has_phase = [&](const std::string& prefix) {
+        return std::any_of(lines.begin(), lines.end(), [&](const std::string& line) { return line.rfind(prefix, 0) == 0; });
+    };
+    ASSERT_TRUE(has_phase("0,left,contraction,"));
+    ASSERT_TRUE(has_phase("0,left,sampling,"));
+    ASSERT_TRUE(has_phase("1,left,subproblem,"));
+    ASSERT_EQ(lines.back().rfind("0,left,subproblem,external,20000,", 0), 0u) << lines.back();
+}
@@ -0,0 +1,128 @@
+/*
+ * TestPresortedSorter.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/hungdefs.hpp"
+#include "../cpp/streaming/basecase/PipelinedKruskal.h"
+#include "../cpp/streaming/containers/PooledSorter.h"
+#include "../cpp/streaming/containers/PresortedSorter.h"
+#include "../cpp/streaming/utils/ParallelRadixSort.h"
+
+class TestPresortedSorter : public ::testing::Test { };
+
+TEST_F(TestPresortedSorter, test_merge_with_pushed) {
+    PresortedSorter<node_component_t, node_component_node_cc_less_cmp> sorter(node_component_node_cc_less_cmp(), SORTER_MEM);
+    for (node_t u : {9, 3, 7, 1}) sorter.push({u, u});
+    for (node_t u : {2, 4, 5, 8}) sorter.push_sorted({u, u});
+    ASSERT_EQ(sorter.size(), 8);
+
+    sorter.sort_reuse();
+    for (int round = 0; round < 2; ++round) {
+        std::vector<node_t> nodes;
+        for (; !sorter.empty(); ++sorter) nodes.push_back((*sorter).node);
+        ASSERT_EQ(nodes, std::vector<node_t>({1, 2, 3, 4, 5, 7, 8, 9}));
+        sorter.rewind();
+    }
+
+    sorter.clear();
+    sorter.push({6, 6});
+    sorter.sort();
+    ASSERT_EQ(sorter.size(), 1);
+    ASSERT_EQ((*sorter).node, 6);
+}
+
+TEST_F(TestPresortedSorter, test_second_run) {
+    // a second presorted run, e.g. of another base case, is merged through the sorter
+    PresortedSorter<node_component_t, node_component_node_cc_less_cmp> sorter(node_component_node_cc_less_cmp(), SORTER_MEM);
+    for (node_t u : {2, 4, 6, 8}) sorter.push_sorted({u, u});
+    for (node_t u : {1, 3, 5, 9, 10}) sorter.push_sorted({u, u});
+    sorter.push({7, 7});
+    ASSERT_EQ(sorter.size(), 10);
+
+    sorter.sort();
+    std::vector<node_t> nodes;
+    for (; !sorter.empty(); ++sorter) nodes.push_back((*sorter).node);
+    ASSERT_EQ(nodes, std::vector<node_t>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+}
+
+TEST_F(TestPresortedSorter, test_radix_sort) {
+    std::mt19937_64 gen(1);
+    for (size_t n : {0, 1, 1000, 300000}) {
+        std::vector<std::pair<uint64_t, size_t>> values(n);
+        for (size_t i = 0; i < n; ++i) values[i] = {gen() >> (i % 2 ? 20 : 40), i};
+        auto expected = values;
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<std::pair<uint64_t, size_t>> buffer(n);
+        parallel_radix_sort(values.data(), buffer.data(), n, [](const auto& v) { return v.first; }, 4);
+        ASSERT_EQ(values, expected);
+    }
+}
+
+TEST_F(TestPresortedSorter, test_kruskal_output) {
+    std::mt19937_64 gen(2);
+    std::uniform_int_distribution<node_t> dist(1, 100000);
+    PipelinedKruskal kruskal;
+    std::vector<edge_t> edges;
+    for (size_t i = 0; i < 50000; ++i) edges.emplace_back(dist(gen), dist(gen));
+    for (const auto& e : edges) kruskal.push(e);
+
+    PresortedSorter<node_component_t, node_component_node_cc_less_cmp> presorted(node_component_node_cc_less_cmp(), SORTER_MEM);
+    kruskal.process(presorted);
+    presorted.sort_reuse();
+
+    PipelinedKruskal reference;
+    for (const auto& e : edges) reference.push(e);
+    stxxl::sorter<node_component_t, node_component_node_cc_less_cmp> sorted(node_component_node_cc_less_cmp(), SORTER_MEM);
+    reference.process(sorted);
+    sorted.sort();
+
+    ASSERT_EQ(presorted.size(), sorted.size());
+    for (; !sorted.empty(); ++sorted, ++presorted) {
+        ASSERT_FALSE(presorted.empty());
+        ASSERT_EQ((*presorted).node, (*sorted).node);
+        ASSERT_EQ((*presorted).load, (*sorted).load);
+    }
+    ASSERT_TRUE(presorted.empty());
+}
+
+TEST_F(TestPresortedSorter, test_pooled) {
+    using sorter_type = PresortedSorter<node_component_t, node_component_node_cc_less_cmp>;
+    SorterPool<sorter_type> pool(node_component_node_cc_less_cmp(), SORTER_MEM, 1);
+    PooledSorter<sorter_type> first(pool);
+    PooledSorter<sorter_type> second(pool);
+    ASSERT_TRUE(accepts_presorted<PooledSorter<sorter_type>>::value);
+
+    // no sorter is taken before the first push
+    first.sort_reuse();
+    ASSERT_TRUE(first.empty());
+    ASSERT_EQ(pool.num_sorters(), 0);
+
+    for (node_t u : {5, 1, 3}) first.push({u, u});
+    first.push_sorted({4, 4});
+    second.push({2, 2});
+    ASSERT_EQ(pool.num_sorters(), 2);
+
+    first.sort_reuse();
+    std::vector<node_t> nodes;
+    for (; !first.empty(); ++first) nodes.push_back((*first).node);
+    ASSERT_EQ(nodes, std::vector<node_t>({1, 3, 4, 5}));
+
+    // one sorter is kept for reuse, the other one is dropped
+    first.clear();
+    second.clear();
+    ASSERT_EQ(pool.num_sorters(), 1);
+    ASSERT_EQ(pool.num_idle(), 1);
+
+    second.push({7, 7});
+    second.sort();
+    ASSERT_EQ(second.size(), 1);
+    ASSERT_EQ((*second).node, 7);
+    ASSERT_EQ(pool.num_idle(), 0);
+}
@@ -0,0 +1,62 @@
+/*
+ * TestSampleClasses.cpp
+ *
+ * Copyright (C) 2020 Hung Tran <hung@ae.cs.uni-frankfurt.de>
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include "../cpp/defs.hpp"
+#include "../cpp/streaming/containers/EdgeStream.h"
+#include "../cpp/streaming/contraction/StarContraction.h"
+#include "../cpp/streaming/FunctionalSubproblemManager.h"
+#include "TestGraphs.h"
+
+class TestSampleClasses : public ::testing::Test { };
+
+namespace {
+    policy_t split_policy(bool contract, unsigned num_classes) {
+        return {
+            [contract](size_t, size_t, unsigned, size_t) { return contract; },
+            [](size_t n, size_t, unsigned, size_t) { return n / 2; },
+            [](size_t, size_t, unsigned, size_t) { return 1; },
+            nullptr,
+            [num_classes](size_t, size_t, unsigned, size_t) { return num_classes; },
+        };
+    }
+}
+
+TEST_F(TestSampleClasses, test_components) {
+    const node_t num_nodes = 20000;
+    const auto edges = random_graph(30000, num_nodes, 4);
+    const auto expected = reference_components(edges);
+    // small enough to recurse a few levels
+    const size_t memory = num_nodes / 8 * sizeof(node_t) * BaseKruskal::MEMORY_OVERHEAD_FACTOR;
+
+    for (bool contract : {false, true}) {
+        for (unsigned num_classes : {2u, 3u, 5u}) {
+            EdgeStream stream;
+            for (const auto& edge : edges) stream.push(edge);
+            stream.consume();
+
+            policy_t policy = split_policy(contract, num_classes);
+            FunctionalSubproblemManager<EdgeStream, StarContraction> funman(stream, memory, num_nodes, policy, 1);
+
+            // the labels partition the nodes like the expected components
+            std::map<node_t, node_t> label_to_component;
+            size_t num_labelled = 0;
+            for (; !funman.empty(); ++funman) {
+                const auto node_cc = *funman;
+                ASSERT_TRUE(expected.count(node_cc.node)) << node_cc.node;
+                const auto component = expected.at(node_cc.node);
+                ASSERT_EQ(label_to_component.emplace(node_cc.load, component).first->second, component) << contract << " " << num_classes;
+                ++num_labelled;
+            }
+            ASSERT_EQ(num_labelled, expected.size()) << contract << " " << num_classes;
+            std::set<node_t> components;
+            for (const auto& [_, component] : label_to_component) components.insert(component);
+            ASSERT_EQ(components.size(), label_to_component.size());
+        }
+    }
+}